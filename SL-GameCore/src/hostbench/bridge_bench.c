@@ -0,0 +1,120 @@
+//
+// Host benchmark of the renderer bridge layer: runs the game's own path (pojavInitOpenGL, pojavCreateContext,
+// pojavMakeCurrent, pojavSwapBuffers) with POJAV_RENDERER=headless_osmesa against the system libOSMesa,
+// so swap and context costs of the bridge can be followed without a device.
+// Each frame clears a set of drifting scissored rectangles, a fill-rate workload that needs no shaders.
+//
+// bridge_bench <path to libOSMesa> [width height frames]
+//
+
+#include <dlfcn.h>
+#include <libgen.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "environ/environ.h"
+#include "ctxbridges/headless_bridge.h"
+#include "ctxbridges/osmesa_loader.h"
+#include "telemetry/histogram.h"
+
+/* Rectangles cleared per frame */
+#define BENCHMARK_RECTS_PER_FRAME 64
+
+int pojavInitOpenGL();
+void* pojavCreateContext(void* contextSrc);
+void pojavMakeCurrent(void* window);
+void pojavSwapBuffers();
+
+static const char* const valueNames[] = {
+        "swaps/s",
+        "init (us)",
+        "context (us)",
+        "make current (us)",
+        "workload (us/frame)",
+        "swap (us/frame)"
+};
+#define VALUE_COUNT (sizeof(valueNames) / sizeof(valueNames[0]))
+
+int main(int argc, char** argv) {
+    if (argc != 2 && argc != 5) {
+        fprintf(stderr, "usage: %s <path to libOSMesa> [width height frames]\n", argv[0]);
+        return 2;
+    }
+    int width = argc > 2 ? atoi(argv[2]) : 1280;
+    int height = argc > 2 ? atoi(argv[3]) : 720;
+    int frames = argc > 2 ? atoi(argv[4]) : 300;
+    if (width <= 0 || height <= 0 || frames <= 0) {
+        fprintf(stderr, "usage: %s <path to libOSMesa> [width height frames]\n", argv[0]);
+        return 2;
+    }
+
+    // dlsym_OSMesa() aborts if the library can't be loaded, check it first
+    if (dlopen(argv[1], RTLD_LAZY | RTLD_LOCAL) == NULL) {
+        fprintf(stderr, "can't load OSMesa: %s\n", dlerror());
+        return 1;
+    }
+    // The bridge looks the library up in POJAV_NATIVEDIR, like it does on the device
+    char* directory = strdup(argv[1]);
+    char* name = strdup(argv[1]);
+    setenv("POJAV_NATIVEDIR", dirname(directory), 1);
+    setenv("LIB_MESA_NAME", basename(name), 1);
+    setenv("POJAV_RENDERER", "headless_osmesa", 1);
+    // Measuring the bridge, not the disk
+    setenv("POJAV_SHADER_CACHE", "0", 1);
+    pojav_environ->savedWidth = width;
+    pojav_environ->savedHeight = height;
+
+    int64_t start = telemetry_now_ns();
+    pojavInitOpenGL();
+    int64_t initTime = telemetry_now_ns() - start;
+
+    start = telemetry_now_ns();
+    void* bundle = pojavCreateContext(NULL);
+    int64_t contextTime = telemetry_now_ns() - start;
+    if (bundle == NULL) {
+        fprintf(stderr, "no headless context\n");
+        return 1;
+    }
+
+    start = telemetry_now_ns();
+    pojavMakeCurrent(bundle);
+    int64_t makeCurrentTime = telemetry_now_ns() - start;
+
+    void (*glEnable_p)(GLenum) = OSMesaGetProcAddress_p("glEnable");
+    void (*glDisable_p)(GLenum) = OSMesaGetProcAddress_p("glDisable");
+    void (*glScissor_p)(GLint, GLint, GLsizei, GLsizei) = OSMesaGetProcAddress_p("glScissor");
+    int64_t workloadTime = 0, swapTime = 0;
+    int64_t benchmarkStart = telemetry_now_ns();
+    for (int frame = 0; frame < frames; frame++) {
+        start = telemetry_now_ns();
+        glDisable_p(GL_SCISSOR_TEST);
+        glClearColor_p(0.1f, 0.1f, 0.1f, 1.0f);
+        glClear_p(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glEnable_p(GL_SCISSOR_TEST);
+        for (int rect = 0; rect < BENCHMARK_RECTS_PER_FRAME; rect++) {
+            // Overlapping rectangles drifting a little every frame
+            int x = (rect * 37 + frame * 5) % width;
+            int y = (rect * 53 + frame * 3) % height;
+            glScissor_p(x, y, width / 4, height / 4);
+            glClearColor_p((float) (rect % 4) / 4, (float) (rect % 7) / 7, (float) (frame % 16) / 16, 1.0f);
+            glClear_p(GL_COLOR_BUFFER_BIT);
+        }
+        int64_t swapStart = telemetry_now_ns();
+        workloadTime += swapStart - start;
+        pojavSwapBuffers();
+        swapTime += telemetry_now_ns() - swapStart;
+    }
+    int64_t benchmarkTime = telemetry_now_ns() - benchmarkStart;
+    hl_destroy_context(bundle);
+    free(directory);
+    free(name);
+
+    double values[] = {
+            (double) frames * 1e9 / (double) benchmarkTime, (double) initTime / 1e3, (double) contextTime / 1e3,
+            (double) makeCurrentTime / 1e3, (double) workloadTime / 1e3 / frames, (double) swapTime / 1e3 / frames
+    };
+    printf("%dx%d, %d frames\n", width, height, frames);
+    for (size_t i = 0; i < VALUE_COUNT; i++) printf("%-20s %10.1f\n", valueNames[i], values[i]);
+    return 0;
+}
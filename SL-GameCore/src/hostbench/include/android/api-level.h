@@ -0,0 +1,12 @@
+//
+// Host stand-in for the NDK API level header, which every bionic header pulls in
+//
+
+#ifndef HOSTBENCH_ANDROID_API_LEVEL_H
+#define HOSTBENCH_ANDROID_API_LEVEL_H
+
+#define __ANDROID_API_FUTURE__ 10000
+
+int android_get_device_api_level(void);
+
+#endif //HOSTBENCH_ANDROID_API_LEVEL_H
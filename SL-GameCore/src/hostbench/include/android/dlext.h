@@ -0,0 +1,10 @@
+//
+// Host stand-in for the NDK dlext header, the benchmarks load libraries with plain dlopen()
+//
+
+#ifndef HOSTBENCH_ANDROID_DLEXT_H
+#define HOSTBENCH_ANDROID_DLEXT_H
+
+#include <dlfcn.h>
+
+#endif //HOSTBENCH_ANDROID_DLEXT_H
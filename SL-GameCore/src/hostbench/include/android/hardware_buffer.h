@@ -0,0 +1,15 @@
+//
+// Host stand-in for the NDK hardware buffer header, only the formats
+//
+
+#ifndef HOSTBENCH_ANDROID_HARDWARE_BUFFER_H
+#define HOSTBENCH_ANDROID_HARDWARE_BUFFER_H
+
+enum AHardwareBuffer_Format {
+    AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM = 1,
+    AHARDWAREBUFFER_FORMAT_R8G8B8X8_UNORM = 2,
+    AHARDWAREBUFFER_FORMAT_R8G8B8_UNORM = 3,
+    AHARDWAREBUFFER_FORMAT_R5G6B5_UNORM = 4,
+};
+
+#endif //HOSTBENCH_ANDROID_HARDWARE_BUFFER_H
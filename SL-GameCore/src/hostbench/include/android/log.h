@@ -0,0 +1,22 @@
+//
+// Host stand-in for the NDK log header, messages go to stderr
+//
+
+#ifndef HOSTBENCH_ANDROID_LOG_H
+#define HOSTBENCH_ANDROID_LOG_H
+
+typedef enum android_LogPriority {
+    ANDROID_LOG_UNKNOWN = 0,
+    ANDROID_LOG_DEFAULT,
+    ANDROID_LOG_VERBOSE,
+    ANDROID_LOG_DEBUG,
+    ANDROID_LOG_INFO,
+    ANDROID_LOG_WARN,
+    ANDROID_LOG_ERROR,
+    ANDROID_LOG_FATAL,
+    ANDROID_LOG_SILENT,
+} android_LogPriority;
+
+int __android_log_print(int prio, const char* tag, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
+
+#endif //HOSTBENCH_ANDROID_LOG_H
@@ -0,0 +1,40 @@
+//
+// Host stand-in for the NDK native window header. The windows are fake ones from
+// stub/fake_window.h, whose buffers are plain memory.
+//
+
+#ifndef HOSTBENCH_ANDROID_NATIVE_WINDOW_H
+#define HOSTBENCH_ANDROID_NATIVE_WINDOW_H
+
+#include <stdint.h>
+#include <android/rect.h>
+#include <android/hardware_buffer.h>
+
+enum ANativeWindow_LegacyFormat {
+    WINDOW_FORMAT_RGBA_8888 = 1,
+    WINDOW_FORMAT_RGBX_8888 = 2,
+    WINDOW_FORMAT_RGB_565 = 4,
+};
+
+struct ANativeWindow;
+typedef struct ANativeWindow ANativeWindow;
+
+typedef struct ANativeWindow_Buffer {
+    int32_t width;
+    int32_t height;
+    int32_t stride; // In pixels
+    int32_t format;
+    void* bits;
+    uint32_t reserved[6];
+} ANativeWindow_Buffer;
+
+void ANativeWindow_acquire(ANativeWindow* window);
+void ANativeWindow_release(ANativeWindow* window);
+int32_t ANativeWindow_getWidth(ANativeWindow* window);
+int32_t ANativeWindow_getHeight(ANativeWindow* window);
+int32_t ANativeWindow_getFormat(ANativeWindow* window);
+int32_t ANativeWindow_setBuffersGeometry(ANativeWindow* window, int32_t width, int32_t height, int32_t format);
+int32_t ANativeWindow_lock(ANativeWindow* window, ANativeWindow_Buffer* outBuffer, ARect* inOutDirtyBounds);
+int32_t ANativeWindow_unlockAndPost(ANativeWindow* window);
+
+#endif //HOSTBENCH_ANDROID_NATIVE_WINDOW_H
@@ -0,0 +1,13 @@
+//
+// Host stand-in for the NDK native window JNI header, there are no Surfaces on the host
+//
+
+#ifndef HOSTBENCH_ANDROID_NATIVE_WINDOW_JNI_H
+#define HOSTBENCH_ANDROID_NATIVE_WINDOW_JNI_H
+
+#include <jni.h>
+#include <android/native_window.h>
+
+ANativeWindow* ANativeWindow_fromSurface(JNIEnv* env, jobject surface);
+
+#endif //HOSTBENCH_ANDROID_NATIVE_WINDOW_JNI_H
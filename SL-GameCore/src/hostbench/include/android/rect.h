@@ -0,0 +1,17 @@
+//
+// Host stand-in for the NDK rect header
+//
+
+#ifndef HOSTBENCH_ANDROID_RECT_H
+#define HOSTBENCH_ANDROID_RECT_H
+
+#include <stdint.h>
+
+typedef struct ARect {
+    int32_t left;
+    int32_t top;
+    int32_t right;
+    int32_t bottom;
+} ARect;
+
+#endif //HOSTBENCH_ANDROID_RECT_H
@@ -0,0 +1,12 @@
+//
+// Host stand-in for the bionic system properties header, every property is empty
+//
+
+#ifndef HOSTBENCH_SYS_SYSTEM_PROPERTIES_H
+#define HOSTBENCH_SYS_SYSTEM_PROPERTIES_H
+
+#define PROP_VALUE_MAX 92
+
+int __system_property_get(const char* name, char* value);
+
+#endif //HOSTBENCH_SYS_SYSTEM_PROPERTIES_H
@@ -0,0 +1,136 @@
+//
+// Host benchmark of the native input path: the send functions, the event queue and the pump,
+// against a scratch window with empty callbacks. Both the critical and the noncritical entry points
+// end up in the same critical_* functions, the cost of the JNI transition itself only shows on a device.
+//
+// input_bench [runs] [--max-ns <ns>]: with --max-ns, fails if the best run of any case is slower.
+//
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "input_harness.h"
+#include "telemetry/histogram.h"
+#include "telemetry/input_replay.h"
+
+#define BENCH_ROUNDS 16
+#define BENCH_BURST 1024
+#define BENCH_SINGLE_EVENTS 4096
+
+static const char* const caseNames[] = {
+        "single key + pump round",
+        "key burst enqueue",
+        "key burst pump",
+        "cursor history burst",
+        "batched keys"
+};
+#define CASE_COUNT (sizeof(caseNames) / sizeof(caseNames[0]))
+
+static volatile int benchSink;
+
+static void benchKeyCallback(__attribute__((unused)) void* window, int key, __attribute__((unused)) int scancode, int action, __attribute__((unused)) int mods) {
+    benchSink += key + action;
+}
+
+static void benchCursorPosCallback(__attribute__((unused)) void* window, double xpos, __attribute__((unused)) double ypos) {
+    benchSink += (int) xpos;
+}
+
+static double nsPerEvent(int64_t elapsed, uint64_t events) {
+    return (double) elapsed / (double) events;
+}
+
+/** One run of every case, in nanoseconds per event */
+static bool runBenchmark(double results[CASE_COUNT]) {
+    long window = (long) &benchSink;
+    if (harness_begin(window, benchKeyCallback, benchCursorPosCallback) == NULL) return false;
+    static input_replay_event_t batch[BENCH_BURST];
+
+    int64_t single = 0, burstEnqueue = 0, burstPump = 0, cursor = 0, batched = 0;
+
+    int64_t start = telemetry_now_ns();
+    for (int i = 0; i < BENCH_SINGLE_EVENTS; i++) {
+        critical_send_key(HARNESS_KEY, 0, i & 1, 0);
+        harness_pump(window);
+    }
+    single = telemetry_now_ns() - start;
+
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        start = telemetry_now_ns();
+        for (int i = 0; i < BENCH_BURST; i++) critical_send_key(HARNESS_KEY, 0, i & 1, 0);
+        int64_t queued = telemetry_now_ns();
+        harness_pump(window);
+        burstEnqueue += queued - start;
+        burstPump += telemetry_now_ns() - queued;
+    }
+
+    pojav_environ->cursorMotionMode = CURSOR_MOTION_HISTORY;
+    pojav_environ->cursorHistoryDepth = BENCH_BURST;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        start = telemetry_now_ns();
+        for (int i = 0; i < BENCH_BURST; i++) critical_send_cursor_pos((float) i, (float) round);
+        harness_pump(window);
+        cursor += telemetry_now_ns() - start;
+    }
+    pojav_environ->cursorMotionMode = CURSOR_MOTION_DIRECT;
+
+    for (int i = 0; i < BENCH_BURST; i++)
+        batch[i] = (input_replay_event_t) { .type = HARNESS_EVENT_TYPE_KEY, .args = { { .i = HARNESS_KEY }, { .i = 0 }, { .i = i & 1 }, { .i = 0 } } };
+    pojav_environ->inputBatchBuffer = batch;
+    pojav_environ->inputBatchCapacity = BENCH_BURST;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        start = telemetry_now_ns();
+        critical_submit_batch(BENCH_BURST);
+        harness_pump(window);
+        batched += telemetry_now_ns() - start;
+    }
+    pojav_environ->inputBatchBuffer = NULL;
+    pojav_environ->inputBatchCapacity = 0;
+
+    harness_end(window);
+
+    uint64_t burstEvents = (uint64_t) BENCH_ROUNDS * BENCH_BURST;
+    results[0] = nsPerEvent(single, BENCH_SINGLE_EVENTS);
+    results[1] = nsPerEvent(burstEnqueue, burstEvents);
+    results[2] = nsPerEvent(burstPump, burstEvents);
+    results[3] = nsPerEvent(cursor, burstEvents);
+    results[4] = nsPerEvent(batched, burstEvents);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    // More runs than there are input slots, each run has to give its slot back
+    int runs = 20;
+    double maxNs = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--max-ns") == 0 && i + 1 < argc) maxNs = atof(argv[++i]);
+        else runs = atoi(argv[i]);
+    }
+    if (runs <= 0) {
+        fprintf(stderr, "usage: %s [runs] [--max-ns <ns>]\n", argv[0]);
+        return 2;
+    }
+
+    double best[CASE_COUNT];
+    for (size_t c = 0; c < CASE_COUNT; c++) best[c] = INFINITY;
+    for (int run = 0; run < runs; run++) {
+        double ns[CASE_COUNT];
+        if (!runBenchmark(ns)) {
+            fprintf(stderr, "run %d: no input slot left for the scratch window\n", run);
+            return 1;
+        }
+        for (size_t c = 0; c < CASE_COUNT; c++) if (ns[c] < best[c]) best[c] = ns[c];
+    }
+
+    int failed = 0;
+    printf("%-26s %12s %16s\n", "best of runs", "ns/event", "events/s");
+    for (size_t c = 0; c < CASE_COUNT; c++) {
+        bool slow = maxNs > 0 && best[c] > maxNs;
+        printf("%-26s %12.1f %16.0f%s\n", caseNames[c], best[c], 1e9 / best[c], slow ? "  SLOWER THAN LIMIT" : "");
+        failed |= slow;
+    }
+    return failed;
+}
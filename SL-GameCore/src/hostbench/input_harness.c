@@ -0,0 +1,42 @@
+//
+// Scratch GLFW window for the input host programs, see input_harness.h
+//
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "input_harness.h"
+#include "stub/jni_stub.h"
+
+JNIEXPORT jlong JNICALL Java_org_lwjgl_glfw_GLFW_nglfwSetKeyCallback(JNIEnv* env, jclass cls, jlong window, jlong callbackptr);
+JNIEXPORT jlong JNICALL Java_org_lwjgl_glfw_GLFW_nglfwSetCursorPosCallback(JNIEnv* env, jclass cls, jlong window, jlong callbackptr);
+JNIEXPORT void JNICALL Java_org_lwjgl_glfw_GLFW_nglfwSetShowingWindow(JNIEnv* env, jclass clazz, jlong window);
+
+GLFWWindowInput* harness_begin(long window, GLFW_invoke_Key_func* keyCallback, GLFW_invoke_CursorPos_func* cursorPosCallback) {
+    // The key and mouse state buffers are the game's GLFW class ones on the device
+    static jbyte keyDownBuffer[512], mouseDownBuffer[32];
+    JNIEnv* env = jni_stub_env();
+    Java_org_lwjgl_glfw_GLFW_nglfwSetKeyCallback(env, NULL, window, (jlong) (uintptr_t) keyCallback);
+    Java_org_lwjgl_glfw_GLFW_nglfwSetCursorPosCallback(env, NULL, window, (jlong) (uintptr_t) cursorPosCallback);
+    Java_org_lwjgl_glfw_GLFW_nglfwSetShowingWindow(env, NULL, window);
+    pojav_environ->keyDownBuffer = keyDownBuffer;
+    pojav_environ->mouseDownBuffer = mouseDownBuffer;
+    pojav_environ->isUseStackQueueCall = true;
+    pojav_environ->isCursorEntered = true;
+    pojav_environ->cursorMotionMode = CURSOR_MOTION_DIRECT;
+    pojav_environ->isInputReady = true;
+    return atomic_load_explicit(&pojav_environ->showingInput, memory_order_acquire);
+}
+
+void harness_end(long window) {
+    JNIEnv* env = jni_stub_env();
+    pojav_environ->isInputReady = false;
+    Java_org_lwjgl_glfw_GLFW_nglfwSetKeyCallback(env, NULL, window, 0);
+    Java_org_lwjgl_glfw_GLFW_nglfwSetCursorPosCallback(env, NULL, window, 0);
+}
+
+void harness_pump(long window) {
+    pojavStartPumping();
+    pojavPumpEvents((void*) window);
+    pojavStopPumping();
+}
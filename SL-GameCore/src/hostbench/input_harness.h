@@ -0,0 +1,38 @@
+//
+// Scratch GLFW window for the input host programs. It gets its callbacks through the same natives
+// LWJGL calls and becomes the showing window, so Android input goes to its queue like it would to a game's.
+//
+
+#ifndef HOSTBENCH_INPUT_HARNESS_H
+#define HOSTBENCH_INPUT_HARNESS_H
+
+#include <jni.h>
+
+#include "environ/environ.h"
+
+#define HARNESS_KEY 65 // GLFW_KEY_A
+
+/* EVENT_TYPE_KEY of input_bridge_v3.c, batch records carry it like CallbackBridge's do */
+#define HARNESS_EVENT_TYPE_KEY 1005
+
+/* The send and pump paths of input_bridge_v3.c, which the Java side reaches through registered natives */
+void critical_send_key(jint key, jint scancode, jint action, jint mods);
+void critical_send_cursor_pos(jfloat x, jfloat y);
+jint critical_submit_batch(jint count);
+void pojavStartPumping();
+void pojavPumpEvents(void* window);
+void pojavStopPumping();
+
+/**
+ * Register the callbacks of window, show it and turn the stack queue on.
+ * @return its input state, NULL if there was no room for it
+ */
+GLFWWindowInput* harness_begin(long window, GLFW_invoke_Key_func* keyCallback, GLFW_invoke_CursorPos_func* cursorPosCallback);
+
+/* Stop taking input and drop the callbacks, which gives the slot of window back */
+void harness_end(long window);
+
+/* One pump round of the game thread */
+void harness_pump(long window);
+
+#endif //HOSTBENCH_INPUT_HARNESS_H
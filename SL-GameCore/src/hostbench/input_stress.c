@@ -0,0 +1,139 @@
+//
+// Stress test of the native input queue from two threads: this one sends a mix of key edges and
+// cursor samples like the Android UI thread, a second one pumps them at 60 fps like the game.
+// Fails if a key edge got lost, dropped or reordered, or if cursor samples went back in time.
+//
+// With --stall, the game thread stops pumping until the queue is full, as if a frame hung.
+// Under INPUT_OVERFLOW_DROP_MOTION that must drop cursor samples only: the key edges keep
+// going into the EVENT_EDGE_RESERVE slots, and all of them still arrive, in order.
+//
+// input_stress [--stall] [events per second] [duration ms]
+//
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "input_harness.h"
+#include "telemetry/histogram.h"
+
+#define STRESS_FRAME_NS 16666667 // The consumer pumps like a game at 60 fps
+#define STRESS_STALL_POLL_NS 1000000
+#define STRESS_STALL_DROPS 256 // Cursor samples dropped before the stall ends, about 85 key edges went to the reserve by then
+#define STRESS_KEY_EVERY 4 // One event in four is a key edge, the others cursor samples
+
+/* Only touched by the consumer thread while the test runs */
+static struct {
+    int nextKey;
+    float lastCursor;
+    long long keysDelivered, cursorDelivered, orderErrors;
+} seen;
+static atomic_bool producerDone;
+static bool stall;
+
+/** Key edges carry their sequence number as the scancode: none may arrive twice or out of order */
+static void stressKeyCallback(__attribute__((unused)) void* window, __attribute__((unused)) int key, int scancode,
+                              __attribute__((unused)) int action, __attribute__((unused)) int mods) {
+    if (scancode < seen.nextKey) seen.orderErrors++;
+    seen.nextKey = scancode + 1;
+    seen.keysDelivered++;
+}
+
+/** Cursor samples may be dropped or skipped, but never go back in time */
+static void stressCursorPosCallback(__attribute__((unused)) void* window, double xpos, __attribute__((unused)) double ypos) {
+    if (xpos <= seen.lastCursor) seen.orderErrors++;
+    seen.lastCursor = (float) xpos;
+    seen.cursorDelivered++;
+}
+
+static void sleepUntil(int64_t deadline) {
+    int64_t now = telemetry_now_ns();
+    if (deadline <= now) return;
+    struct timespec delay = { .tv_sec = (deadline - now) / 1000000000, .tv_nsec = (deadline - now) % 1000000000 };
+    nanosleep(&delay, NULL);
+}
+
+static void* consumer(void* window) {
+    GLFWInputRing* ring = &atomic_load_explicit(&pojav_environ->showingInput, memory_order_acquire)->ring;
+    // Dropped cursor samples mean the motion slots are full, the key edges sent meanwhile only fit in the reserve
+    while (stall && atomic_load_explicit(&ring->droppedMotion, memory_order_relaxed) < STRESS_STALL_DROPS
+           && !atomic_load_explicit(&producerDone, memory_order_acquire)) {
+        sleepUntil(telemetry_now_ns() + STRESS_STALL_POLL_NS);
+    }
+    int64_t frame = telemetry_now_ns();
+    bool done;
+    do {
+        // Read before pumping, so the last round sees everything the producer sent
+        done = atomic_load_explicit(&producerDone, memory_order_acquire);
+        harness_pump((long) window);
+        frame += STRESS_FRAME_NS;
+        sleepUntil(frame);
+    } while (!done);
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    int arg = 1;
+    if (arg < argc && strcmp(argv[arg], "--stall") == 0) {
+        stall = true;
+        arg++;
+    }
+    int eventsPerSecond = arg < argc ? atoi(argv[arg++]) : 10000;
+    int durationMs = arg < argc ? atoi(argv[arg++]) : 2000;
+    if (eventsPerSecond <= 0 || durationMs <= 0) {
+        fprintf(stderr, "usage: %s [--stall] [events per second] [duration ms]\n", argv[0]);
+        return 2;
+    }
+
+    long window = (long) &seen;
+    GLFWWindowInput* input = harness_begin(window, stressKeyCallback, stressCursorPosCallback);
+    if (input == NULL) {
+        fprintf(stderr, "no input slot for the scratch window\n");
+        return 1;
+    }
+    pojav_environ->cursorMotionMode = CURSOR_MOTION_HISTORY;
+    pojav_environ->cursorHistoryDepth = EVENT_WINDOW_SIZE;
+    pojav_environ->inputOverflowPolicy = INPUT_OVERFLOW_DROP_MOTION;
+    seen.lastCursor = -1;
+
+    pthread_t consumerThread;
+    if (pthread_create(&consumerThread, NULL, consumer, (void*) window) != 0) {
+        fprintf(stderr, "can't start the consumer thread\n");
+        return 1;
+    }
+    long long events = (long long) eventsPerSecond * durationMs / 1000, keysSent = 0, cursorSent = 0;
+    int64_t interval = 1000000000LL / eventsPerSecond, start = telemetry_now_ns();
+    for (long long i = 0; i < events; i++) {
+        sleepUntil(start + i * interval);
+        if (i % STRESS_KEY_EVERY == 0) {
+            critical_send_key(HARNESS_KEY, (jint) keysSent, (jint) (keysSent & 1), 0);
+            keysSent++;
+        } else {
+            critical_send_cursor_pos((float) cursorSent, 0);
+            cursorSent++;
+        }
+    }
+    atomic_store_explicit(&producerDone, true, memory_order_release);
+    pthread_join(consumerThread, NULL);
+
+    long long droppedMotion = (long long) atomic_load_explicit(&input->ring.droppedMotion, memory_order_relaxed);
+    long long droppedEdges = (long long) atomic_load_explicit(&input->ring.droppedEdges, memory_order_relaxed);
+    harness_end(window);
+
+    printf("%d events/s for %d ms%s\n", eventsPerSecond, durationMs, stall ? ", stalled until the queue is full" : "");
+    printf("keys delivered      %lld/%lld\n", seen.keysDelivered, keysSent);
+    printf("cursor delivered    %lld/%lld\n", seen.cursorDelivered, cursorSent);
+    printf("motion dropped      %lld\n", droppedMotion);
+    printf("edges dropped       %lld\n", droppedEdges);
+    printf("order errors        %lld\n", seen.orderErrors);
+    int failed = seen.keysDelivered != keysSent || droppedEdges != 0 || seen.orderErrors != 0;
+    if (stall && droppedMotion < STRESS_STALL_DROPS) {
+        fprintf(stderr, "the queue never filled up, send more events\n");
+        failed = 1;
+    }
+    return failed;
+}
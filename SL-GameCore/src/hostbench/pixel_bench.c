@@ -0,0 +1,159 @@
+//
+// Host benchmark of the pixel kernels, with a check of their output against plain C first,
+// so the vector paths of the host (SSE2 on x86) can't get faster by getting wrong.
+//
+// pixel_bench [width height iterations]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pixel_kernels.h"
+#include "telemetry/histogram.h"
+
+static const char* const kernelNames[] = {
+        "rgbx copy",
+        "rgbx copy flipped",
+        "rgb565",
+        "swizzle",
+        "flip in place",
+        "rgb565 dithered",
+        "32x32 tile hashing"
+};
+#define KERNEL_COUNT (int) (sizeof(kernelNames) / sizeof(kernelNames[0]))
+
+/* Odd sizes and padded strides, so the scalar tails of the rows get exercised as well */
+#define CHECK_WIDTH 67
+#define CHECK_HEIGHT 33
+#define CHECK_SRC_STRIDE 80
+#define CHECK_DST_STRIDE 72
+
+static uint32_t referenceRgbx(uint32_t pixel) {
+    return pixel | 0xFF000000u;
+}
+
+static uint16_t referenceRgb565(uint32_t pixel) {
+    uint32_t r = pixel & 0xFF, g = (pixel >> 8) & 0xFF, b = (pixel >> 16) & 0xFF;
+    return (uint16_t) (((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+}
+
+static uint32_t referenceSwizzle(uint32_t pixel) {
+    return (pixel & 0xFF00FF00u) | ((pixel & 0xFF) << 16) | ((pixel >> 16) & 0xFF);
+}
+
+static int check(const char* name, int bad) {
+    if (bad) fprintf(stderr, "%s: %d wrong pixels\n", name, bad);
+    return bad != 0;
+}
+
+static int checkKernels() {
+    static uint32_t src[CHECK_HEIGHT * CHECK_SRC_STRIDE], dst[CHECK_HEIGHT * CHECK_DST_STRIDE];
+    static uint16_t dst565[CHECK_HEIGHT * CHECK_DST_STRIDE];
+    for (size_t i = 0; i < sizeof(src) / sizeof(src[0]); i++) src[i] = (uint32_t) (i * 2654435761u);
+    int failed = 0;
+
+    for (int flip = 0; flip <= 1; flip++) {
+        int bad = 0;
+        pk_copy_rgba_to_rgbx(dst, CHECK_DST_STRIDE, src, CHECK_SRC_STRIDE, CHECK_WIDTH, CHECK_HEIGHT, flip);
+        for (int y = 0; y < CHECK_HEIGHT; y++) {
+            int srcY = flip ? CHECK_HEIGHT - 1 - y : y;
+            for (int x = 0; x < CHECK_WIDTH; x++)
+                bad += dst[y * CHECK_DST_STRIDE + x] != referenceRgbx(src[srcY * CHECK_SRC_STRIDE + x]);
+        }
+        failed |= check(flip ? "rgbx copy flipped" : "rgbx copy", bad);
+    }
+
+    int bad = 0;
+    pk_rgba_to_rgb565(dst565, CHECK_DST_STRIDE, src, CHECK_SRC_STRIDE, CHECK_WIDTH, CHECK_HEIGHT, false);
+    for (int y = 0; y < CHECK_HEIGHT; y++)
+        for (int x = 0; x < CHECK_WIDTH; x++)
+            bad += dst565[y * CHECK_DST_STRIDE + x] != referenceRgb565(src[y * CHECK_SRC_STRIDE + x]);
+    failed |= check("rgb565", bad);
+
+    bad = 0;
+    pk_swizzle_rb(dst, CHECK_DST_STRIDE, src, CHECK_SRC_STRIDE, CHECK_WIDTH, CHECK_HEIGHT, false);
+    for (int y = 0; y < CHECK_HEIGHT; y++)
+        for (int x = 0; x < CHECK_WIDTH; x++)
+            bad += dst[y * CHECK_DST_STRIDE + x] != referenceSwizzle(src[y * CHECK_SRC_STRIDE + x]);
+    failed |= check("swizzle", bad);
+
+    bad = 0;
+    memcpy(dst, src, sizeof(dst));
+    pk_flip_vertical(dst, CHECK_DST_STRIDE, CHECK_WIDTH, CHECK_HEIGHT);
+    for (int y = 0; y < CHECK_HEIGHT; y++)
+        for (int x = 0; x < CHECK_WIDTH; x++)
+            bad += dst[y * CHECK_DST_STRIDE + x] != src[(CHECK_HEIGHT - 1 - y) * CHECK_DST_STRIDE + x];
+    failed |= check("flip in place", bad);
+
+    // One changed pixel changes the hash of its own tile and of no other
+    enum { TILE = 16, TILES_X = (CHECK_WIDTH + TILE - 1) / TILE, TILES = TILES_X * ((CHECK_HEIGHT + TILE - 1) / TILE) };
+    uint64_t before[TILES], after[TILES];
+    pk_hash_tiles(before, src, CHECK_SRC_STRIDE, CHECK_WIDTH, CHECK_HEIGHT, TILE);
+    int changedX = CHECK_WIDTH - 1, changedY = CHECK_HEIGHT / 2;
+    src[changedY * CHECK_SRC_STRIDE + changedX] ^= 1;
+    pk_hash_tiles(after, src, CHECK_SRC_STRIDE, CHECK_WIDTH, CHECK_HEIGHT, TILE);
+    bad = 0;
+    for (int tile = 0; tile < TILES; tile++)
+        bad += (before[tile] != after[tile]) != (tile == changedY / TILE * TILES_X + changedX / TILE);
+    failed |= check("tile hashing", bad);
+
+    return failed;
+}
+
+/* Measure the kernels on a frame of the given size, false if it can't be allocated */
+static bool benchmark(double* megapixelsPerSecond, int width, int height, int iterations) {
+    if (width <= 0 || height <= 0 || iterations <= 0) return false;
+    size_t pixels = (size_t) width * height;
+    uint32_t* src = malloc(pixels * sizeof(uint32_t));
+    uint32_t* dst = malloc(pixels * sizeof(uint32_t));
+    uint64_t* hashes = malloc((size_t) ((width + 31) / 32) * ((height + 31) / 32) * sizeof(uint64_t));
+    if (src == NULL || dst == NULL || hashes == NULL) {
+        free(src);
+        free(dst);
+        free(hashes);
+        return false;
+    }
+    for (size_t i = 0; i < pixels; i++) src[i] = (uint32_t) (i * 2654435761u);
+
+    for (int kernel = 0; kernel < KERNEL_COUNT; kernel++) {
+        int64_t start = telemetry_now_ns();
+        for (int i = 0; i < iterations; i++) {
+            switch (kernel) {
+                case 0: pk_copy_rgba_to_rgbx(dst, width, src, width, width, height, false); break;
+                case 1: pk_copy_rgba_to_rgbx(dst, width, src, width, width, height, true); break;
+                case 2: pk_rgba_to_rgb565((uint16_t*) dst, width, src, width, width, height, false); break;
+                case 3: pk_swizzle_rb(dst, width, src, width, width, height, false); break;
+                case 4: pk_flip_vertical(dst, width, width, height); break;
+                case 5: pk_rgba_to_rgb565_dither((uint16_t*) dst, width, src, width, width, height, false); break;
+                case 6: pk_hash_tiles(hashes, src, width, width, height, 32); break;
+            }
+        }
+        int64_t elapsed = telemetry_now_ns() - start;
+        megapixelsPerSecond[kernel] = (double) pixels * iterations / ((double) elapsed / 1e3);
+    }
+    free(src);
+    free(dst);
+    free(hashes);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int width = argc > 3 ? atoi(argv[1]) : 1920;
+    int height = argc > 3 ? atoi(argv[2]) : 1080;
+    int iterations = argc > 3 ? atoi(argv[3]) : 100;
+
+    if (checkKernels()) return 1;
+
+    double megapixelsPerSecond[KERNEL_COUNT];
+    if (!benchmark(megapixelsPerSecond, width, height, iterations)) {
+        fprintf(stderr, "can't benchmark a %dx%d frame %d times\n", width, height, iterations);
+        return 1;
+    }
+    printf("%dx%d, %d iterations\n", width, height, iterations);
+    printf("%-20s %10s %10s\n", "kernel", "MP/s", "frames/s");
+    for (int kernel = 0; kernel < KERNEL_COUNT; kernel++)
+        printf("%-20s %10.0f %10.0f\n", kernelNames[kernel], megapixelsPerSecond[kernel],
+               megapixelsPerSecond[kernel] * 1e6 / ((double) width * height));
+    return 0;
+}
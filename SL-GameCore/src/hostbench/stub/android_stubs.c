@@ -0,0 +1,132 @@
+//
+// What the host benchmarks need from Android: logging, native windows, system properties,
+// and the hooks that only make sense inside the game VM.
+//
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <android/api-level.h>
+#include <android/log.h>
+#include <android/native_window_jni.h>
+#include <sys/system_properties.h>
+
+#include "fake_window.h"
+
+struct ANativeWindow {
+    int width, height; // Size of the surface
+    int bufferWidth, bufferHeight, format; // Geometry requested by setBuffersGeometry(), 0 for the surface's own
+    int refs;
+    long posts;
+    void* bits;
+    size_t bitsSize;
+    int locked;
+};
+
+int __android_log_print(int prio, const char* tag, const char* fmt, ...) {
+    static const char levels[] = "??VDIWEFS";
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "%c/%s: ", prio >= 0 && prio < (int) sizeof(levels) - 1 ? levels[prio] : '?', tag);
+    int written = vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+    va_end(args);
+    return written;
+}
+
+ANativeWindow* fake_window_create(int width, int height) {
+    ANativeWindow* window = calloc(1, sizeof(ANativeWindow));
+    if (window == NULL) abort();
+    window->width = width;
+    window->height = height;
+    window->format = WINDOW_FORMAT_RGBA_8888;
+    window->refs = 1;
+    return window;
+}
+
+void fake_window_destroy(ANativeWindow* window) {
+    if (window->refs != 1) fprintf(stderr, "fake window destroyed with %d references\n", window->refs);
+    free(window->bits);
+    free(window);
+}
+
+void fake_window_resize(ANativeWindow* window, int width, int height) {
+    window->width = width;
+    window->height = height;
+}
+
+long fake_window_posts(ANativeWindow* window) {
+    return window->posts;
+}
+
+void ANativeWindow_acquire(ANativeWindow* window) {
+    window->refs++;
+}
+
+void ANativeWindow_release(ANativeWindow* window) {
+    window->refs--;
+}
+
+int32_t ANativeWindow_getWidth(ANativeWindow* window) {
+    return window->bufferWidth ? window->bufferWidth : window->width;
+}
+
+int32_t ANativeWindow_getHeight(ANativeWindow* window) {
+    return window->bufferHeight ? window->bufferHeight : window->height;
+}
+
+int32_t ANativeWindow_getFormat(ANativeWindow* window) {
+    return window->format;
+}
+
+int32_t ANativeWindow_setBuffersGeometry(ANativeWindow* window, int32_t width, int32_t height, int32_t format) {
+    window->bufferWidth = width;
+    window->bufferHeight = height;
+    if (format != 0) window->format = format;
+    return 0;
+}
+
+int32_t ANativeWindow_lock(ANativeWindow* window, ANativeWindow_Buffer* outBuffer, ARect* inOutDirtyBounds) {
+    if (window->locked) return -1;
+    int width = ANativeWindow_getWidth(window), height = ANativeWindow_getHeight(window);
+    // Like gralloc, rows are padded, so the stride rarely matches the width
+    int stride = (width + 15) & ~15;
+    size_t size = (size_t) stride * height * (window->format == WINDOW_FORMAT_RGB_565 ? 2 : 4);
+    if (size > window->bitsSize) {
+        free(window->bits);
+        window->bits = malloc(size);
+        if (window->bits == NULL) abort();
+        window->bitsSize = size;
+    }
+    *outBuffer = (ANativeWindow_Buffer) {
+            .width = width, .height = height, .stride = stride, .format = window->format, .bits = window->bits
+    };
+    // A single buffer keeps its content, so the dirty bounds never have to grow
+    (void) inOutDirtyBounds;
+    window->locked = 1;
+    return 0;
+}
+
+int32_t ANativeWindow_unlockAndPost(ANativeWindow* window) {
+    if (!window->locked) return -1;
+    window->locked = 0;
+    window->posts++;
+    return 0;
+}
+
+ANativeWindow* ANativeWindow_fromSurface(__attribute__((unused)) JNIEnv* env, __attribute__((unused)) jobject surface) {
+    return NULL;
+}
+
+int android_get_device_api_level(void) {
+    return __ANDROID_API_FUTURE__;
+}
+
+int __system_property_get(__attribute__((unused)) const char* name, char* value) {
+    value[0] = '\0';
+    return 0;
+}
+
+/* Only installed in the game VM, which the benchmarks don't start */
+void hookExec() {}
+void installLwjglDlopenHook() {}
@@ -0,0 +1,19 @@
+//
+// Fake ANativeWindow for the host benchmarks: buffers are malloc'd memory and posting one only counts it.
+//
+
+#ifndef HOSTBENCH_FAKE_WINDOW_H
+#define HOSTBENCH_FAKE_WINDOW_H
+
+#include <android/native_window.h>
+
+ANativeWindow* fake_window_create(int width, int height);
+void fake_window_destroy(ANativeWindow* window);
+
+/* Changes the size of the surface, like a rotation or a split screen would */
+void fake_window_resize(ANativeWindow* window, int width, int height);
+
+/* Buffers posted with ANativeWindow_unlockAndPost() so far */
+long fake_window_posts(ANativeWindow* window);
+
+#endif //HOSTBENCH_FAKE_WINDOW_H
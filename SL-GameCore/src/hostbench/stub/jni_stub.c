@@ -0,0 +1,95 @@
+//
+// Stub JNIEnv, see jni_stub.h
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "jni_stub.h"
+
+typedef struct {
+    jsize length;
+    size_t elementSize;
+    _Alignas(8) unsigned char elements[];
+} stub_array_t;
+
+static jarray newArray(jsize length, size_t elementSize) {
+    stub_array_t* array = calloc(1, sizeof(stub_array_t) + (size_t) length * elementSize);
+    if (array == NULL) return NULL;
+    array->length = length;
+    array->elementSize = elementSize;
+    return (jarray) array;
+}
+
+static void setRegion(jarray array, jsize start, jsize length, const void* buf) {
+    stub_array_t* stub = (stub_array_t*) array;
+    if (start < 0 || length < 0 || start + length > stub->length) {
+        fprintf(stderr, "jni stub: array region %d+%d out of bounds (%d)\n", start, length, stub->length);
+        abort();
+    }
+    memcpy(stub->elements + (size_t) start * stub->elementSize, buf, (size_t) length * stub->elementSize);
+}
+
+static jdoubleArray stubNewDoubleArray(__attribute__((unused)) JNIEnv* env, jsize length) {
+    return newArray(length, sizeof(jdouble));
+}
+
+static jlongArray stubNewLongArray(__attribute__((unused)) JNIEnv* env, jsize length) {
+    return newArray(length, sizeof(jlong));
+}
+
+static void stubSetDoubleArrayRegion(__attribute__((unused)) JNIEnv* env, jdoubleArray array, jsize start, jsize length, const jdouble* buf) {
+    setRegion(array, start, length, buf);
+}
+
+static void stubSetLongArrayRegion(__attribute__((unused)) JNIEnv* env, jlongArray array, jsize start, jsize length, const jlong* buf) {
+    setRegion(array, start, length, buf);
+}
+
+static const char* stubGetStringUTFChars(__attribute__((unused)) JNIEnv* env, jstring string, jboolean* isCopy) {
+    if (isCopy != NULL) *isCopy = JNI_FALSE;
+    return (const char*) string;
+}
+
+static void stubReleaseStringUTFChars(__attribute__((unused)) JNIEnv* env, __attribute__((unused)) jstring string,
+                                      __attribute__((unused)) const char* utf) {}
+
+static jboolean stubExceptionCheck(__attribute__((unused)) JNIEnv* env) {
+    return JNI_FALSE;
+}
+
+static void stubExceptionClear(__attribute__((unused)) JNIEnv* env) {}
+
+static __typeof__(*(JNIEnv) 0) stubInterface = {
+        .NewDoubleArray = stubNewDoubleArray,
+        .NewLongArray = stubNewLongArray,
+        .SetDoubleArrayRegion = stubSetDoubleArrayRegion,
+        .SetLongArrayRegion = stubSetLongArrayRegion,
+        .GetStringUTFChars = stubGetStringUTFChars,
+        .ReleaseStringUTFChars = stubReleaseStringUTFChars,
+        .ExceptionCheck = stubExceptionCheck,
+        .ExceptionClear = stubExceptionClear,
+};
+
+static JNIEnv stubEnv = &stubInterface;
+
+JNIEnv* jni_stub_env() {
+    return &stubEnv;
+}
+
+jstring jni_stub_string(const char* utf) {
+    return (jstring) utf;
+}
+
+jsize jni_stub_length(jarray array) {
+    return ((stub_array_t*) array)->length;
+}
+
+const void* jni_stub_elements(jarray array) {
+    return ((stub_array_t*) array)->elements;
+}
+
+void jni_stub_free(jarray array) {
+    free(array);
+}
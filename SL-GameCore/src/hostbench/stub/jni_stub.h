@@ -0,0 +1,21 @@
+//
+// Just enough of a JNIEnv to call the benchmark entry points from a plain program:
+// primitive arrays are malloc'd blocks, which the caller frees with jni_stub_free(),
+// and strings are the C strings given to jni_stub_string().
+// Calling anything else crashes on its NULL function pointer.
+//
+
+#ifndef HOSTBENCH_JNI_STUB_H
+#define HOSTBENCH_JNI_STUB_H
+
+#include <jni.h>
+
+JNIEnv* jni_stub_env();
+
+jstring jni_stub_string(const char* utf);
+
+jsize jni_stub_length(jarray array);
+const void* jni_stub_elements(jarray array);
+void jni_stub_free(jarray array);
+
+#endif //HOSTBENCH_JNI_STUB_H
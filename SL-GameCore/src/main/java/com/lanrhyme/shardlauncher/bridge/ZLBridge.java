@@ -23,6 +23,8 @@ import android.content.Context;
 
 import androidx.annotation.Keep;
 
+import java.nio.ByteBuffer;
+
 @Keep
 public final class ZLBridge {
     // AWT
@@ -59,6 +61,29 @@ public final class ZLBridge {
         sendInputData(EVENT_TYPE_CURSOR_POS, x, y, 0, 0);
     }
 
+    // Frame statistics, byte offsets in the buffer from getFrameStatsBuffer()
+    public static final int FRAME_STATS_SEQUENCE = 0;
+    public static final int FRAME_STATS_FRAMES = 4;
+    public static final int FRAME_STATS_HEAD = 8;
+    public static final int FRAME_STATS_FPS = 12;
+    public static final int FRAME_STATS_P50 = 16;
+    public static final int FRAME_STATS_P95 = 20;
+    public static final int FRAME_STATS_P99 = 24;
+    public static final int FRAME_STATS_MAX = 28;
+    public static final int FRAME_STATS_HITCHES = 32;
+    public static final int FRAME_STATS_FRAME_TIMES = 36;
+    public static final int FRAME_STATS_HISTORY = 512;
+
+    /**
+     * Copy a consistent snapshot of the frame statistics. The copy is taken natively, where the render
+     * thread's updates can be fenced against.
+     * @param summary receives { frames, fps, p50, p95, p99, max, hitches }, frame times in microseconds
+     * @param frameTimes if not null, receives the latest frame times, newest first
+     * @return how many frame times were copied
+     */
+    @Keep
+    public static native int readFrameStats(int[] summary, int[] frameTimes);
+
     // Game
     @Keep
     public static native void initializeGameExitHook();
@@ -80,6 +105,35 @@ public final class ZLBridge {
     @Keep
     public static native void releaseBridgeWindow();
 
+    /**
+     * Pace the frames to the given rate, 0 to disable. Also set by POJAV_FPS_LIMIT (and POJAV_FPS_LIMIT_ADAPTIVE=1).
+     * @param adaptive lower the target while the device can't keep up with it, e.g. when throttling
+     */
+    @Keep
+    public static native void setFrameLimit(int fps, boolean adaptive);
+
+    /**
+     * @return the frame rate currently paced to, lower than the configured one while adapting, 0 if disabled
+     */
+    @Keep
+    public static native int getFrameLimit();
+
+    /**
+     * Render the game at a fraction of the surface resolution, the compositor stretches it back.
+     * Also set by POJAV_RENDER_SCALE, POJAV_RENDER_SCALE_TARGET_FPS, POJAV_RENDER_SCALE_MIN and POJAV_RENDER_SHARPNESS.
+     * @param scale scale of each dimension, up to 1. With a target frame rate, the highest scale used
+     * @param targetFps lower the scale (down to minScale) whenever the game falls short of this frame rate, 0 to keep it fixed
+     * @param sharpness strength of the sharpening applied to scaled frames (0-1), OSMesa based renderers only
+     */
+    @Keep
+    public static native void setRenderScale(float scale, int targetFps, float minScale, float sharpness);
+
+    /**
+     * @return the render scale in use right now
+     */
+    @Keep
+    public static native float getRenderScale();
+
     @Keep
     public static native void moveWindow(int xOffset, int yOffset);
 
@@ -93,6 +147,61 @@ public final class ZLBridge {
     @Keep
     public static native void clipboardReceived(String data, String mimeTypeSub);
 
+    /**
+     * Input latency of the current session, in microseconds:
+     * { queue count, p50, p95, p99, max, present count, p50, p95, p99, max }.
+     * Queue latency ends when the game receives the event, present latency at the first swap after that.
+     */
+    @Keep
+    public static native long[] getInputLatencyStats();
+
+    /**
+     * Record every input event sent to the game, with its timing, until {@link #stopInputRecording()}.
+     * Can also be started with the POJAV_INPUT_RECORD environment variable.
+     */
+    @Keep
+    public static native boolean startInputRecording(String path);
+
+    @Keep
+    public static native void stopInputRecording();
+
+    /**
+     * Feed a recording back to the game with its original timing. Input from the screen is ignored meanwhile.
+     * Can also be started with the POJAV_INPUT_REPLAY (and POJAV_INPUT_REPLAY_LOOP=1) environment variables.
+     */
+    @Keep
+    public static native boolean startInputReplay(String path, boolean loop);
+
+    @Keep
+    public static native void stopInputReplay();
+
+    // Telemetry
+    /**
+     * Live frame statistics written by the render thread on every swap, see the FRAME_STATS_* offsets.
+     * Plain reads from Java can't be ordered against the render thread, use {@link #readFrameStats(int[], int[])}
+     * for consistent values.
+     */
+    @Keep
+    public static native ByteBuffer getFrameStatsBuffer();
+
+    /**
+     * How long window changes stalled the render thread, in microseconds:
+     * { full swap count, p50, p95, max, in place resize count, p50, p95, max }.
+     * Full swaps recreate the window surface, resizes only happen when the window itself stayed the same.
+     */
+    @Keep
+    public static native long[] getSurfaceSwapStats();
+
+    /**
+     * State of the shader cache of the current renderer:
+     * { files at startup, bytes at startup, files now, bytes now, files written this session (misses),
+     * -1 for the hits (nothing on disk records reads, /data is noatime), evicted files, evicted bytes,
+     * 1 if a previous driver version was dropped }.
+     * Null when the renderer's cache isn't managed by the launcher.
+     */
+    @Keep
+    public static native long[] getShaderCacheStats();
+
     // Utils
     @Keep
     public static native int chdir(String path);
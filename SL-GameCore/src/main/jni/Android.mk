@@ -23,13 +23,26 @@ LOCAL_SRC_FILES := \
     ctxbridges/br_loader.c \
     ctxbridges/gl_bridge.c \
     ctxbridges/osm_bridge.c \
+    ctxbridges/headless_bridge.c \
     ctxbridges/egl_loader.c \
     ctxbridges/osmesa_loader.c \
     ctxbridges/swap_interval_no_egl.c \
     ctxbridges/virgl_bridge.c \
+    ctxbridges/render_scale.c \
+    ctxbridges/pixel_kernels.c \
+    ctxbridges/gl_profiler.c \
+    ctxbridges/shader_cache.c \
     environ/environ.c \
     logger/logger.c \
     input_bridge_v3.c \
+    gesture_engine.c \
+    frame_limiter.c \
+    jni_attach.c \
+    upcall_dispatcher.c \
+    telemetry/input_latency.c \
+    telemetry/frame_time.c \
+    telemetry/surface_swap.c \
+    telemetry/input_replay.c \
     jre_launcher.c \
     utils.c \
     stdio_is.c \
@@ -78,7 +91,9 @@ include $(BUILD_SHARED_LIBRARY)
 include $(CLEAR_VARS)
 LOCAL_MODULE := pojavexec_awt
 LOCAL_SRC_FILES := \
-    awt_bridge.c
+    awt_bridge.c \
+    jni_attach.c \
+    logger/logger.c
 include $(BUILD_SHARED_LIBRARY)
 
 
@@ -3,11 +3,11 @@
 #include <string.h>
 #include <stdio.h>
 
+#include "jni_attach.h"
+
 static JavaVM* dalvikJavaVMPtr;
 
 static JavaVM* runtimeJavaVMPtr;
-static JNIEnv* runtimeJNIEnvPtr_GRAPHICS;
-static JNIEnv* runtimeJNIEnvPtr_INPUT;
 jclass class_CTCScreen;
 jmethodID method_GetRGB;
 
@@ -51,13 +51,8 @@ jint JNI_OnLoad(JavaVM* vm, void* reserved) {
 }
 
 JNIEXPORT void JNICALL Java_com_lanrhyme_shardlauncher_bridge_ZLBridge_sendInputData(JNIEnv* env, jclass clazz, jint type, jint i1, jint i2, jint i3, jint i4) {
-    if (runtimeJNIEnvPtr_INPUT == NULL) {
-        if (runtimeJavaVMPtr == NULL) {
-            return;
-        } else {
-            (*runtimeJavaVMPtr)->AttachCurrentThread(runtimeJavaVMPtr, &runtimeJNIEnvPtr_INPUT, NULL);
-        }
-    }
+    JNIEnv* runtimeJNIEnvPtr_INPUT = jni_attach_env(runtimeJavaVMPtr);
+    if (runtimeJNIEnvPtr_INPUT == NULL) return;
 
     if (method_ReceiveInput == NULL) {
         class_CTCAndroidInput = (*runtimeJNIEnvPtr_INPUT)->FindClass(runtimeJNIEnvPtr_INPUT, "net/java/openjdk/cacio/ctc/CTCAndroidInput");
@@ -81,13 +76,8 @@ JNIEXPORT void JNICALL Java_com_lanrhyme_shardlauncher_bridge_ZLBridge_sendInput
 // int printed = 0;
 int threadAttached = 0;
 JNIEXPORT jintArray JNICALL Java_com_lanrhyme_shardlauncher_bridge_ZLBridge_renderAWTScreenFrame(JNIEnv* env, jclass clazz /*, jobject canvas, jint width, jint height */) {
-    if (runtimeJNIEnvPtr_GRAPHICS == NULL) {
-        if (runtimeJavaVMPtr == NULL) {
-            return NULL;
-        } else {
-            (*runtimeJavaVMPtr)->AttachCurrentThread(runtimeJavaVMPtr, &runtimeJNIEnvPtr_GRAPHICS, NULL);
-        }
-    }
+    JNIEnv* runtimeJNIEnvPtr_GRAPHICS = jni_attach_env(runtimeJavaVMPtr);
+    if (runtimeJNIEnvPtr_GRAPHICS == NULL) return NULL;
 
     int *rgbArray;
     jintArray jreRgbArray, androidRgbArray;
@@ -125,25 +115,18 @@ JNIEXPORT jintArray JNICALL Java_com_lanrhyme_shardlauncher_bridge_ZLBridge_rend
 }
 
 JNIEXPORT void JNICALL Java_net_java_openjdk_cacio_ctc_CTCClipboard_nQuerySystemClipboard(JNIEnv *env, jclass clazz) {
-    JNIEnv *dalvikEnv;char detachable = 0;
-    if((*dalvikJavaVMPtr)->GetEnv(dalvikJavaVMPtr, (void **) &dalvikEnv, JNI_VERSION_1_6) == JNI_EDETACHED) {
-        (*dalvikJavaVMPtr)->AttachCurrentThread(dalvikJavaVMPtr, &dalvikEnv, NULL);
-        detachable = 1;
-    }
+    JNIEnv *dalvikEnv = jni_attach_env(dalvikJavaVMPtr);
+    if (dalvikEnv == NULL) return;
     if(method_SystemClipboardDataReceived == NULL) {
         class_CTCClipboard = (*env)->NewGlobalRef(env, clazz);
         method_SystemClipboardDataReceived = (*env)->GetStaticMethodID(env, clazz, "systemClipboardDataReceived", "(Ljava/lang/String;Ljava/lang/String;)V");
     }
     (*dalvikEnv)->CallStaticVoidMethod(dalvikEnv, class_ZLInvoker, method_QuerySystemClipboard);
-    if(detachable) (*dalvikJavaVMPtr)->DetachCurrentThread(dalvikJavaVMPtr);
 }
 
 JNIEXPORT void JNICALL Java_net_java_openjdk_cacio_ctc_CTCClipboard_nPutClipboardData(JNIEnv* env, jclass clazz, jstring clipboardData, jstring clipboardDataMime) {
-    JNIEnv *dalvikEnv;char detachable = 0;
-    if((*dalvikJavaVMPtr)->GetEnv(dalvikJavaVMPtr, (void **) &dalvikEnv, JNI_VERSION_1_6) == JNI_EDETACHED) {
-        (*dalvikJavaVMPtr)->AttachCurrentThread(dalvikJavaVMPtr, &dalvikEnv, NULL);
-        detachable = 1;
-    }
+    JNIEnv *dalvikEnv = jni_attach_env(dalvikJavaVMPtr);
+    if (dalvikEnv == NULL) return;
 
     const char* dataChars = (*env)->GetStringUTFChars(env, clipboardData, NULL);
     const char* mimeChars = (*env)->GetStringUTFChars(env, clipboardDataMime, NULL);
@@ -152,7 +135,6 @@ JNIEXPORT void JNICALL Java_net_java_openjdk_cacio_ctc_CTCClipboard_nPutClipboar
                                        (*dalvikEnv)->NewStringUTF(dalvikEnv, mimeChars));
     (*env)->ReleaseStringUTFChars(env, clipboardData, dataChars);
     (*env)->ReleaseStringUTFChars(env, clipboardDataMime, mimeChars);
-    if(detachable) (*dalvikJavaVMPtr)->DetachCurrentThread(dalvikJavaVMPtr);
 }
 
 JNIEXPORT void JNICALL Java_com_github_caciocavallosilano_cacio_ctc_CTCClipboard_nQuerySystemClipboard(JNIEnv *env, jclass clazz) {
@@ -164,38 +146,25 @@ JNIEXPORT void JNICALL Java_com_github_caciocavallosilano_cacio_ctc_CTCClipboard
 }
 
 JNIEXPORT void JNICALL Java_net_java_openjdk_cacio_ctc_CTCDesktopPeer_openFile(JNIEnv *env, jclass clazz, jstring filePath) {
-    JNIEnv *dalvikEnv;char detachable = 0;
-    if((*dalvikJavaVMPtr)->GetEnv(dalvikJavaVMPtr, (void **) &dalvikEnv, JNI_VERSION_1_6) == JNI_EDETACHED) {
-        (*dalvikJavaVMPtr)->AttachCurrentThread(dalvikJavaVMPtr, &dalvikEnv, NULL);
-        detachable = 1;
-    }
+    JNIEnv *dalvikEnv = jni_attach_env(dalvikJavaVMPtr);
+    if (dalvikEnv == NULL) return;
     const char* stringChars = (*env)->GetStringUTFChars(env, filePath, NULL);
     (*dalvikEnv)->CallStaticVoidMethod(dalvikEnv, class_ZLInvoker, method_OpenPath, (*dalvikEnv)->NewStringUTF(dalvikEnv, stringChars));
     (*env)->ReleaseStringUTFChars(env, filePath, stringChars);
-    if(detachable) (*dalvikJavaVMPtr)->DetachCurrentThread(dalvikJavaVMPtr);
 }
 
 JNIEXPORT void JNICALL Java_net_java_openjdk_cacio_ctc_CTCDesktopPeer_openUri(JNIEnv *env, jclass clazz, jstring uri) {
-    JNIEnv *dalvikEnv;char detachable = 0;
-    if((*dalvikJavaVMPtr)->GetEnv(dalvikJavaVMPtr, (void **) &dalvikEnv, JNI_VERSION_1_6) == JNI_EDETACHED) {
-        (*dalvikJavaVMPtr)->AttachCurrentThread(dalvikJavaVMPtr, &dalvikEnv, NULL);
-        detachable = 1;
-    }
+    JNIEnv *dalvikEnv = jni_attach_env(dalvikJavaVMPtr);
+    if (dalvikEnv == NULL) return;
     const char* stringChars = (*env)->GetStringUTFChars(env, uri, NULL);
     (*dalvikEnv)->CallStaticVoidMethod(dalvikEnv, class_ZLInvoker, method_OpenLink, (*dalvikEnv)->NewStringUTF(dalvikEnv, stringChars));
     (*env)->ReleaseStringUTFChars(env, uri, stringChars);
-    if(detachable) (*dalvikJavaVMPtr)->DetachCurrentThread(dalvikJavaVMPtr);
 }
 
 JNIEXPORT void JNICALL Java_com_lanrhyme_shardlauncher_bridge_ZLBridge_clipboardReceived(JNIEnv *env, jclass clazz, jstring clipboardData, jstring clipboardDataMime) {
     if(method_SystemClipboardDataReceived == NULL || class_CTCClipboard == NULL) return;
-    if (runtimeJNIEnvPtr_INPUT == NULL) {
-        if (runtimeJavaVMPtr == NULL) {
-            return;
-        } else {
-            (*runtimeJavaVMPtr)->AttachCurrentThread(runtimeJavaVMPtr, &runtimeJNIEnvPtr_INPUT, NULL);
-        }
-    }
+    JNIEnv* runtimeJNIEnvPtr_INPUT = jni_attach_env(runtimeJavaVMPtr);
+    if (runtimeJNIEnvPtr_INPUT == NULL) return;
     const char* dataChars = clipboardData != NULL ? (*env)->GetStringUTFChars(env, clipboardData, NULL) : NULL;
     const char* mimeChars = clipboardDataMime != NULL ? (*env)->GetStringUTFChars(env, clipboardDataMime, NULL) : NULL;
     (*runtimeJNIEnvPtr_INPUT)->CallStaticVoidMethod(runtimeJNIEnvPtr_INPUT, class_CTCClipboard, method_SystemClipboardDataReceived,
@@ -207,13 +176,8 @@ JNIEXPORT void JNICALL Java_com_lanrhyme_shardlauncher_bridge_ZLBridge_clipboard
 
 JNIEXPORT void JNICALL
 Java_com_lanrhyme_shardlauncher_bridge_ZLBridge_moveWindow(JNIEnv *env, jclass clazz, jint xoff, jint yoff) {
-    if (runtimeJNIEnvPtr_INPUT == NULL) {
-        if (runtimeJavaVMPtr == NULL) {
-            return;
-        } else {
-            (*runtimeJavaVMPtr)->AttachCurrentThread(runtimeJavaVMPtr, &runtimeJNIEnvPtr_INPUT, NULL);
-        }
-    }
+    JNIEnv* runtimeJNIEnvPtr_INPUT = jni_attach_env(runtimeJavaVMPtr);
+    if (runtimeJNIEnvPtr_INPUT == NULL) return;
     if(field_y == NULL) {
         class_Frame = (*runtimeJNIEnvPtr_INPUT)->FindClass(runtimeJNIEnvPtr_INPUT, "java/awt/Frame");
         method_GetFrames = (*runtimeJNIEnvPtr_INPUT)->GetStaticMethodID(runtimeJNIEnvPtr_INPUT, class_Frame, "getFrames", "()[Ljava/awt/Frame;");
@@ -7,6 +7,7 @@
 #include "br_loader.h"
 #include "egl_loader.h"
 #include "osmesa_loader.h"
+#include "gl_profiler.h"
 
 __eglMustCastToProperFunctionPointerType (*eglGetProcAddress_p) (const char *procname);
 void* (*OSMesaGetProcAddress_p)(const char* funcName);
@@ -26,11 +27,11 @@ void* OSMGetProcAddress(void* handle, const char* symbol_name) {
         void* symbol = OSMesaGetProcAddress_p(symbol_name);
         if (symbol)
         {
-            return symbol;
+            return gl_profiler_wrap(symbol_name, symbol);
         }
         fprintf(stderr, "Error[OSM Loader]: 'OSMesaGetProcAddress' could not find symbol '%s'.\n", symbol_name);
     }
-    return load_symbol(handle, symbol_name);
+    return gl_profiler_wrap(symbol_name, load_symbol(handle, symbol_name));
 }
 
 void* GLGetProcAddress(void* handle, const char* symbol_name) {
@@ -40,9 +41,9 @@ void* GLGetProcAddress(void* handle, const char* symbol_name) {
         void* symbol = (void*) eglGetProcAddress_p(symbol_name);
         if (symbol)
         {
-            return symbol;
+            return gl_profiler_wrap(symbol_name, symbol);
         }
         fprintf(stderr, "Error[GL Loader]: 'eglGetProcAddress' could not find symbol '%s'.\n", symbol_name);
     }
-    return load_symbol(handle, symbol_name);
+    return gl_profiler_wrap(symbol_name, load_symbol(handle, symbol_name));
 }
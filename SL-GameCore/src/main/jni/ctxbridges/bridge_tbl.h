@@ -8,6 +8,7 @@
 #include <ctxbridges/common.h>
 #include <ctxbridges/gl_bridge.h>
 #include <ctxbridges/osm_bridge.h>
+#include <ctxbridges/headless_bridge.h>
 
 typedef basic_render_window_t* (*br_init_context_t)(basic_render_window_t* share);
 typedef void (*br_make_current_t)(basic_render_window_t* bundle);
@@ -20,6 +21,8 @@ br_get_current_t br_get_current = NULL;
 void (*br_swap_buffers)() = NULL;
 void (*br_setup_window)() = NULL;
 void (*br_swap_interval)(int swapInterval) = NULL;
+void* (*br_acquire_worker_context)() = NULL;
+void (*br_release_worker_context)(void* worker) = NULL;
 
 
 void set_osm_bridge_tbl() {
@@ -32,6 +35,18 @@ void set_osm_bridge_tbl() {
     br_swap_interval = osm_swap_interval;
 }
 
+void set_headless_bridge_tbl() {
+    br_init = hl_init;
+    br_init_context = (br_init_context_t) hl_init_context;
+    br_make_current = (br_make_current_t) hl_make_current;
+    br_get_current = (br_get_current_t) hl_get_current;
+    br_swap_buffers = hl_swap_buffers;
+    br_setup_window = hl_setup_window;
+    br_swap_interval = hl_swap_interval;
+    br_acquire_worker_context = NULL;
+    br_release_worker_context = NULL;
+}
+
 void set_gl_bridge_tbl() {
     br_init = gl_init;
     br_init_context = (br_init_context_t) gl_init_context;
@@ -40,6 +55,8 @@ void set_gl_bridge_tbl() {
     br_swap_buffers = gl_swap_buffers;
     br_setup_window = gl_setup_window;
     br_swap_interval = gl_swap_interval;
+    br_acquire_worker_context = gl_acquire_worker_context;
+    br_release_worker_context = gl_release_worker_context;
 }
 
 #endif //POJAVLAUNCHER_BRIDGE_TBL_H
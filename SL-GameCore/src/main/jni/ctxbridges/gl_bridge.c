@@ -7,9 +7,13 @@
 #include <stdlib.h>
 #include <dlfcn.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 #include <environ/environ.h>
 #include "gl_bridge.h"
 #include "egl_loader.h"
+#include "render_scale.h"
+#include "telemetry/histogram.h"
+#include "telemetry/surface_swap.h"
 
 //
 // Created by maks on 17.09.2022.
@@ -19,6 +23,93 @@ static const char* g_LogTag = "GLBridge";
 static __thread gl_render_window_t* currentBundle;
 static EGLDisplay g_EglDisplay;
 
+// Everything a context is created from, resolved once by gl_init()
+static struct {
+    bool resolved;
+    EGLConfig config;
+    EGLint format;
+    EGLenum api;
+    EGLint contextAttributes[3];
+    int64_t resolveTime;
+} g_ContextSetup;
+static __thread bool g_ApiBound;
+
+// Worker contexts: shared with the first context, each with its own 1x1 pbuffer.
+// Nothing uses them unless asked for, so there are none unless POJAV_WORKER_CONTEXTS is set.
+// A set bit in g_WorkerFree is a worker that can be acquired
+#define MAX_WORKER_CONTEXTS 8
+typedef struct {
+    EGLContext context;
+    EGLSurface surface;
+} gl_worker_context_t;
+static gl_worker_context_t g_Workers[MAX_WORKER_CONTEXTS];
+static atomic_uint g_WorkerFree;
+static void (*g_WorkerFinish)(void);
+
+// Context creation counters, to see what resolving the setup once saves
+static atomic_int g_ContextCount;
+static atomic_llong g_ContextCreateTime;
+
+static void gl_bind_api() {
+    // The bound API is per thread, contexts may come from any of them
+    if (g_ApiBound) return;
+    if (eglBindAPI_p(g_ContextSetup.api)) g_ApiBound = true;
+    else printf("EGLBridge: bind failed: %p\n", eglGetError_p());
+}
+
+static bool gl_resolve_context_setup() {
+    int64_t start = telemetry_now_ns();
+    EGLint egl_attributes[] = { EGL_BLUE_SIZE, 8,
+                    EGL_GREEN_SIZE, 8,
+                    EGL_RED_SIZE, 8,
+                    EGL_ALPHA_SIZE, 8,
+                    EGL_DEPTH_SIZE, 24,
+                    EGL_SURFACE_TYPE,
+                    EGL_WINDOW_BIT|EGL_PBUFFER_BIT,
+                    EGL_RENDERABLE_TYPE,
+                    EGL_OPENGL_ES2_BIT,
+                    EGL_NONE
+                    };
+    EGLint num_configs = 0;
+
+    if (eglChooseConfig_p(g_EglDisplay, egl_attributes, &g_ContextSetup.config, 1, &num_configs) != EGL_TRUE)
+    {
+        __android_log_print(ANDROID_LOG_ERROR, g_LogTag, "eglChooseConfig_p() failed: %04x",
+                            eglGetError_p());
+        return false;
+    }
+
+    if (num_configs == 0)
+    {
+        __android_log_print(ANDROID_LOG_ERROR, g_LogTag, "%s",
+                            "eglChooseConfig_p() found no matching config");
+        return false;
+    }
+
+    eglGetConfigAttrib_p(g_EglDisplay, g_ContextSetup.config, EGL_NATIVE_VISUAL_ID, &g_ContextSetup.format);
+
+    if (!strncmp(getenv("POJAV_RENDERER"), "opengles3_desktopgl", 19))
+    {
+        printf("EGLBridge: Binding to OpenGL\n");
+        g_ContextSetup.api = EGL_OPENGL_API;
+    } else {
+        printf("EGLBridge: Binding to OpenGL ES\n");
+        g_ContextSetup.api = EGL_OPENGL_ES_API;
+    }
+
+    int libgl_es = strtol(getenv("LIBGL_ES"), NULL, 0);
+    if (libgl_es < 0 || libgl_es > INT16_MAX) libgl_es = 2;
+    g_ContextSetup.contextAttributes[0] = EGL_CONTEXT_CLIENT_VERSION;
+    g_ContextSetup.contextAttributes[1] = libgl_es;
+    g_ContextSetup.contextAttributes[2] = EGL_NONE;
+
+    g_ContextSetup.resolved = true;
+    g_ContextSetup.resolveTime = telemetry_now_ns() - start;
+    __android_log_print(ANDROID_LOG_INFO, g_LogTag, "Context setup resolved in %lld us",
+                        (long long) (g_ContextSetup.resolveTime / 1000));
+    return true;
+}
+
 bool gl_init() {
     dlsym_EGL();
     g_EglDisplay = eglGetDisplay_p(EGL_DEFAULT_DISPLAY);
@@ -35,7 +126,7 @@ bool gl_init() {
                             eglGetError_p());
         return false;
     }
-    return true;
+    return gl_resolve_context_setup();
 }
 
 gl_render_window_t* gl_get_current() {
@@ -55,59 +146,98 @@ static void gl4esi_get_display_dimensions(int* width, int* height) {
     *height = 0;
 }
 
-gl_render_window_t* gl_init_context(gl_render_window_t *share) {
-    gl_render_window_t* bundle = malloc(sizeof(gl_render_window_t));
-    memset(bundle, 0, sizeof(gl_render_window_t));
-    EGLint egl_attributes[] = { EGL_BLUE_SIZE, 8,
-                    EGL_GREEN_SIZE, 8,
-                    EGL_RED_SIZE, 8,
-                    EGL_ALPHA_SIZE, 8,
-                    EGL_DEPTH_SIZE, 24,
-                    EGL_SURFACE_TYPE,
-                    EGL_WINDOW_BIT|EGL_PBUFFER_BIT,
-                    EGL_RENDERABLE_TYPE,
-                    EGL_OPENGL_ES2_BIT,
-                    EGL_NONE
-                    };
-    EGLint num_configs = 0;
+static void* gl_resolve_finish() {
+    // eglGetProcAddress only has to return core functions since EGL 1.5, older drivers want dlsym
+    void* finish = (void*) eglGetProcAddress_p("glFinish");
+    if (finish != NULL) return finish;
+    const char* gles = getenv("LIBGL_GLES");
+    void* handle = gles != NULL ? dlopen(gles, RTLD_LOCAL | RTLD_LAZY) : NULL;
+    if (handle == NULL) handle = dlopen("libGLESv2.so", RTLD_LOCAL | RTLD_LAZY);
+    return handle != NULL ? dlsym(handle, "glFinish") : NULL;
+}
 
-    if (eglChooseConfig_p(g_EglDisplay, egl_attributes, NULL, 0, &num_configs) != EGL_TRUE)
+static void gl_init_worker_contexts(EGLContext share) {
+    const char* countEnv = getenv("POJAV_WORKER_CONTEXTS");
+    int count = countEnv != NULL ? atoi(countEnv) : 0;
+    if (count <= 0) return;
+    if (count > MAX_WORKER_CONTEXTS) count = MAX_WORKER_CONTEXTS;
+    g_WorkerFinish = (void (*)(void)) gl_resolve_finish();
+    if (g_WorkerFinish == NULL)
     {
-        __android_log_print(ANDROID_LOG_ERROR, g_LogTag, "eglChooseConfig_p() failed: %04x",
-                            eglGetError_p());
-        free(bundle);
-        return NULL;
+        // Without it the uploads of a released worker aren't guaranteed to be visible to the others
+        __android_log_print(ANDROID_LOG_ERROR, g_LogTag, "%s", "glFinish not found, no worker contexts");
+        return;
+    }
+    const EGLint pbuffer_attrs[] = {EGL_WIDTH, 1 , EGL_HEIGHT, 1, EGL_NONE};
+    unsigned int free = 0;
+    for (int i = 0; i < count; i++)
+    {
+        gl_worker_context_t* worker = &g_Workers[i];
+        worker->context = eglCreateContext_p(g_EglDisplay, g_ContextSetup.config, share, g_ContextSetup.contextAttributes);
+        if (worker->context == EGL_NO_CONTEXT) break;
+        worker->surface = eglCreatePbufferSurface_p(g_EglDisplay, g_ContextSetup.config, pbuffer_attrs);
+        if (worker->surface == EGL_NO_SURFACE)
+        {
+            eglDestroyContext_p(g_EglDisplay, worker->context);
+            break;
+        }
+        free |= 1u << i;
     }
+    atomic_store_explicit(&g_WorkerFree, free, memory_order_release);
+    __android_log_print(ANDROID_LOG_INFO, g_LogTag, "Created %d of %d worker contexts",
+                        __builtin_popcount(free), count);
+}
 
-    if (num_configs == 0)
+/**
+ * Take a worker context from the pool and make it current on the calling thread.
+ * @return the worker, to be given back with gl_release_worker_context(), or NULL if none is left
+ */
+void* gl_acquire_worker_context() {
+    unsigned int free = atomic_load_explicit(&g_WorkerFree, memory_order_acquire);
+    int index;
+    do {
+        if (free == 0) return NULL;
+        index = __builtin_ctz(free);
+    } while (!atomic_compare_exchange_weak_explicit(&g_WorkerFree, &free, free & ~(1u << index),
+                                                    memory_order_acquire, memory_order_acquire));
+
+    gl_worker_context_t* worker = &g_Workers[index];
+    gl_bind_api();
+    if (!eglMakeCurrent_p(g_EglDisplay, worker->surface, worker->surface, worker->context))
     {
-        __android_log_print(ANDROID_LOG_ERROR, g_LogTag, "%s",
-                            "eglChooseConfig_p() found no matching config");
-        free(bundle);
+        __android_log_print(ANDROID_LOG_ERROR, g_LogTag, "Worker eglMakeCurrent returned with error: %04x", eglGetError_p());
+        atomic_fetch_or_explicit(&g_WorkerFree, 1u << index, memory_order_release);
         return NULL;
     }
+    return worker;
+}
 
-    eglChooseConfig_p(g_EglDisplay, egl_attributes, &bundle->config, 1, &num_configs);
-    eglGetConfigAttrib_p(g_EglDisplay, bundle->config, EGL_NATIVE_VISUAL_ID, &bundle->format);
+/** Release the worker context current on the calling thread back to the pool */
+void gl_release_worker_context(void* worker) {
+    if (worker == NULL) return;
+    int index = (int) ((gl_worker_context_t*) worker - g_Workers);
+    // Make sure the uploads are visible to the other contexts before someone else takes this one
+    if (g_WorkerFinish != NULL) g_WorkerFinish();
+    eglMakeCurrent_p(g_EglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    atomic_fetch_or_explicit(&g_WorkerFree, 1u << index, memory_order_release);
+}
 
+gl_render_window_t* gl_init_context(gl_render_window_t *share) {
+    if (!g_ContextSetup.resolved)
     {
-        EGLBoolean bindResult;
-
-        if (!strncmp(getenv("POJAV_RENDERER"), "opengles3_desktopgl", 19))
-        {
-            printf("EGLBridge: Binding to OpenGL\n");
-            bindResult = eglBindAPI_p(EGL_OPENGL_API);
-        } else {
-            printf("EGLBridge: Binding to OpenGL ES\n");
-            bindResult = eglBindAPI_p(EGL_OPENGL_ES_API);
-        }
-        if (!bindResult) printf("EGLBridge: bind failed: %p\n", eglGetError_p());
+        __android_log_print(ANDROID_LOG_ERROR, g_LogTag, "%s",
+                            "No context setup, gl_init() failed or wasn't called");
+        return NULL;
     }
+    int64_t start = telemetry_now_ns();
+    gl_render_window_t* bundle = malloc(sizeof(gl_render_window_t));
+    memset(bundle, 0, sizeof(gl_render_window_t));
+    bundle->config = g_ContextSetup.config;
+    bundle->format = g_ContextSetup.format;
 
-    int libgl_es = strtol(getenv("LIBGL_ES"), NULL, 0);
-    if (libgl_es < 0 || libgl_es > INT16_MAX) libgl_es = 2;
-    const EGLint egl_context_attributes[] = { EGL_CONTEXT_CLIENT_VERSION, libgl_es, EGL_NONE };
-    bundle->context = eglCreateContext_p(g_EglDisplay, bundle->config, share == NULL ? EGL_NO_CONTEXT : share->context, egl_context_attributes);
+    gl_bind_api();
+
+    bundle->context = eglCreateContext_p(g_EglDisplay, bundle->config, share == NULL ? EGL_NO_CONTEXT : share->context, g_ContextSetup.contextAttributes);
 
     if (bundle->context == EGL_NO_CONTEXT)
     {
@@ -116,6 +246,15 @@ gl_render_window_t* gl_init_context(gl_render_window_t *share) {
         free(bundle);
         return NULL;
     }
+
+    int64_t createTime = telemetry_now_ns() - start;
+    int count = atomic_fetch_add(&g_ContextCount, 1) + 1;
+    long long totalTime = atomic_fetch_add(&g_ContextCreateTime, createTime) + createTime;
+    __android_log_print(ANDROID_LOG_INFO, g_LogTag,
+                        "Context #%d created in %lld us (total %lld us), resolving the setup once saved ~%lld us",
+                        count, (long long) (createTime / 1000), totalTime / 1000,
+                        (long long) ((count - 1) * g_ContextSetup.resolveTime / 1000));
+    if (share == NULL && count == 1) gl_init_worker_contexts(bundle->context);
     return bundle;
 }
 
@@ -132,7 +271,7 @@ void gl_swap_surface(gl_render_window_t* bundle) {
         bundle->nativeSurface = bundle->newNativeSurface;
         bundle->newNativeSurface = NULL;
         ANativeWindow_acquire(bundle->nativeSurface);
-        ANativeWindow_setBuffersGeometry(bundle->nativeSurface, 0, 0, bundle->format);
+        render_scale_set_geometry(bundle->nativeSurface, bundle->format);
         bundle->surface = eglCreateWindowSurface_p(g_EglDisplay, bundle->config, bundle->nativeSurface, NULL);
     } else {
         __android_log_print(ANDROID_LOG_ERROR, g_LogTag, "No new native surface, switching to 1x1 pbuffer");
@@ -142,6 +281,19 @@ void gl_swap_surface(gl_render_window_t* bundle) {
     }
 }
 
+/**
+ * Take a window change without recreating the EGL surface when the native window stayed the same,
+ * only its geometry needs to be applied again. The surface follows from the next buffer on.
+ * @return false if the surface has to be swapped for real
+ */
+static bool gl_resize_surface(gl_render_window_t* bundle) {
+    if (bundle->surface == NULL || bundle->nativeSurface == NULL || bundle->newNativeSurface != bundle->nativeSurface)
+        return false;
+    bundle->newNativeSurface = NULL;
+    render_scale_set_geometry(bundle->nativeSurface, bundle->format);
+    return true;
+}
+
 void gl_make_current(gl_render_window_t* bundle) {
 
     if (bundle == NULL)
@@ -183,10 +335,16 @@ void gl_make_current(gl_render_window_t* bundle) {
 void gl_swap_buffers() {
     if (currentBundle->state == STATE_RENDERER_NEW_WINDOW)
     {
-        eglMakeCurrent_p(g_EglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
-        gl_swap_surface(currentBundle);
-        eglMakeCurrent_p(g_EglDisplay, currentBundle->surface, currentBundle->surface, currentBundle->context);
+        int64_t start = telemetry_now_ns();
+        bool resized = gl_resize_surface(currentBundle);
+        if (!resized)
+        {
+            eglMakeCurrent_p(g_EglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            gl_swap_surface(currentBundle);
+            eglMakeCurrent_p(g_EglDisplay, currentBundle->surface, currentBundle->surface, currentBundle->context);
+        }
         currentBundle->state = STATE_RENDERER_ALIVE;
+        surface_swap_record(telemetry_now_ns() - start, resized);
     }
 
     if (currentBundle->surface != NULL)
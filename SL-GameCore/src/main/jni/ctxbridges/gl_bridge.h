@@ -23,6 +23,8 @@ void gl_make_current(gl_render_window_t* bundle);
 void gl_swap_buffers();
 void gl_setup_window();
 void gl_swap_interval(int swapInterval);
+void* gl_acquire_worker_context();
+void gl_release_worker_context(void* worker);
 
 
 #endif //POJAVLAUNCHER_GL_BRIDGE_H
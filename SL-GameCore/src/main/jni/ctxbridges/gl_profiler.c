@@ -0,0 +1,241 @@
+//
+// GL call profiler, see gl_profiler.h
+//
+// Each wrapper bumps a counter and calls the real entry point. The counters are shared by all
+// the threads, the workers upload textures too, and are swapped out at every frame end.
+// Texture upload sizes are computed from the format and type, ignoring the unpack alignment.
+// A name resolved to two different entry points (two GL libraries) is only profiled for the first.
+//
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include "logger/logger.h"
+#include "telemetry/histogram.h"
+#include "gl_profiler.h"
+
+#define FLUSH_INTERVAL_FRAMES 60
+
+static struct {
+    atomic_uint_fast64_t draws;
+    atomic_uint_fast64_t stateChanges;
+    atomic_uint_fast64_t bufferUploads, bufferBytes;
+    atomic_uint_fast64_t textureUploads, textureBytes;
+    atomic_uint_fast64_t stalls, stallNs;
+} counters;
+
+static bool envChecked;
+static const char* tracePath;
+static FILE* traceFile;
+static uint64_t frame;
+static int64_t lastFrameTime;
+
+#define COUNT(counter, amount) atomic_fetch_add_explicit(&counters.counter, (amount), memory_order_relaxed)
+
+static size_t texel_size(GLenum format, GLenum type) {
+    size_t components;
+    switch (format) {
+        case GL_RED: case GL_RED_INTEGER: case GL_ALPHA: case GL_LUMINANCE:
+        case GL_DEPTH_COMPONENT: case GL_STENCIL_INDEX:
+            components = 1; break;
+        case GL_RG: case GL_RG_INTEGER: case GL_LUMINANCE_ALPHA: case GL_DEPTH_STENCIL:
+            components = 2; break;
+        case GL_RGB: case GL_BGR: case GL_RGB_INTEGER:
+            components = 3; break;
+        default:
+            components = 4; break;
+    }
+    switch (type) {
+        case GL_UNSIGNED_BYTE: case GL_BYTE:
+            return components;
+        case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT:
+            return components * 2;
+        case GL_UNSIGNED_INT: case GL_INT: case GL_FLOAT:
+            return components * 4;
+        case GL_UNSIGNED_SHORT_5_6_5: case GL_UNSIGNED_SHORT_4_4_4_4: case GL_UNSIGNED_SHORT_5_5_5_1:
+            return 2;
+        default: // The packed 32-bit types
+            return 4;
+    }
+}
+
+/* Wrappers, one per profiled entry point */
+
+#define WRAP(ret, name, params, args, before) \
+    static ret (*real_##name) params; \
+    static ret wrap_##name params { before; return real_##name args; }
+
+#define WRAP_VOID(name, params, args, before) \
+    static void (*real_##name) params; \
+    static void wrap_##name params { before; real_##name args; }
+
+#define WRAP_STALL_VOID(name, params, args) \
+    static void (*real_##name) params; \
+    static void wrap_##name params { \
+        int64_t start = telemetry_now_ns(); \
+        real_##name args; \
+        COUNT(stalls, 1); \
+        COUNT(stallNs, telemetry_now_ns() - start); \
+    }
+
+WRAP_VOID(glDrawArrays, (GLenum mode, GLint first, GLsizei count), (mode, first, count), COUNT(draws, 1))
+WRAP_VOID(glDrawElements, (GLenum mode, GLsizei count, GLenum type, const void* indices), (mode, count, type, indices), COUNT(draws, 1))
+WRAP_VOID(glDrawRangeElements, (GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type, const void* indices),
+          (mode, start, end, count, type, indices), COUNT(draws, 1))
+WRAP_VOID(glDrawArraysInstanced, (GLenum mode, GLint first, GLsizei count, GLsizei instances), (mode, first, count, instances), COUNT(draws, 1))
+WRAP_VOID(glDrawElementsInstanced, (GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instances),
+          (mode, count, type, indices, instances), COUNT(draws, 1))
+WRAP_VOID(glDrawElementsBaseVertex, (GLenum mode, GLsizei count, GLenum type, const void* indices, GLint baseVertex),
+          (mode, count, type, indices, baseVertex), COUNT(draws, 1))
+WRAP_VOID(glMultiDrawArrays, (GLenum mode, const GLint* first, const GLsizei* count, GLsizei drawCount),
+          (mode, first, count, drawCount), COUNT(draws, drawCount))
+WRAP_VOID(glMultiDrawElements, (GLenum mode, const GLsizei* count, GLenum type, const void* const* indices, GLsizei drawCount),
+          (mode, count, type, indices, drawCount), COUNT(draws, drawCount))
+
+WRAP_VOID(glEnable, (GLenum cap), (cap), COUNT(stateChanges, 1))
+WRAP_VOID(glDisable, (GLenum cap), (cap), COUNT(stateChanges, 1))
+WRAP_VOID(glBlendFunc, (GLenum src, GLenum dst), (src, dst), COUNT(stateChanges, 1))
+WRAP_VOID(glBlendFuncSeparate, (GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha), (srcRGB, dstRGB, srcAlpha, dstAlpha), COUNT(stateChanges, 1))
+WRAP_VOID(glDepthFunc, (GLenum func), (func), COUNT(stateChanges, 1))
+WRAP_VOID(glDepthMask, (GLboolean flag), (flag), COUNT(stateChanges, 1))
+WRAP_VOID(glColorMask, (GLboolean r, GLboolean g, GLboolean b, GLboolean a), (r, g, b, a), COUNT(stateChanges, 1))
+WRAP_VOID(glCullFace, (GLenum mode), (mode), COUNT(stateChanges, 1))
+WRAP_VOID(glPolygonOffset, (GLfloat factor, GLfloat units), (factor, units), COUNT(stateChanges, 1))
+WRAP_VOID(glViewport, (GLint x, GLint y, GLsizei width, GLsizei height), (x, y, width, height), COUNT(stateChanges, 1))
+WRAP_VOID(glScissor, (GLint x, GLint y, GLsizei width, GLsizei height), (x, y, width, height), COUNT(stateChanges, 1))
+WRAP_VOID(glUseProgram, (GLuint program), (program), COUNT(stateChanges, 1))
+WRAP_VOID(glActiveTexture, (GLenum texture), (texture), COUNT(stateChanges, 1))
+WRAP_VOID(glBindTexture, (GLenum target, GLuint texture), (target, texture), COUNT(stateChanges, 1))
+WRAP_VOID(glBindBuffer, (GLenum target, GLuint buffer), (target, buffer), COUNT(stateChanges, 1))
+WRAP_VOID(glBindVertexArray, (GLuint array), (array), COUNT(stateChanges, 1))
+WRAP_VOID(glBindFramebuffer, (GLenum target, GLuint framebuffer), (target, framebuffer), COUNT(stateChanges, 1))
+
+WRAP_VOID(glBufferData, (GLenum target, GLsizeiptr size, const void* data, GLenum usage), (target, size, data, usage),
+          if (data != NULL) { COUNT(bufferUploads, 1); COUNT(bufferBytes, size); })
+WRAP_VOID(glBufferSubData, (GLenum target, GLintptr offset, GLsizeiptr size, const void* data), (target, offset, size, data),
+          COUNT(bufferUploads, 1); COUNT(bufferBytes, size))
+WRAP(void*, glMapBufferRange, (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access), (target, offset, length, access),
+     if (access & GL_MAP_WRITE_BIT) { COUNT(bufferUploads, 1); COUNT(bufferBytes, length); })
+
+WRAP_VOID(glTexImage2D, (GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels),
+          (target, level, internalFormat, width, height, border, format, type, pixels),
+          if (pixels != NULL) { COUNT(textureUploads, 1); COUNT(textureBytes, (size_t) width * height * texel_size(format, type)); })
+WRAP_VOID(glTexSubImage2D, (GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels),
+          (target, level, x, y, width, height, format, type, pixels),
+          COUNT(textureUploads, 1); COUNT(textureBytes, (size_t) width * height * texel_size(format, type)))
+WRAP_VOID(glTexImage3D, (GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const void* pixels),
+          (target, level, internalFormat, width, height, depth, border, format, type, pixels),
+          if (pixels != NULL) { COUNT(textureUploads, 1); COUNT(textureBytes, (size_t) width * height * depth * texel_size(format, type)); })
+WRAP_VOID(glTexSubImage3D, (GLenum target, GLint level, GLint x, GLint y, GLint z, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels),
+          (target, level, x, y, z, width, height, depth, format, type, pixels),
+          COUNT(textureUploads, 1); COUNT(textureBytes, (size_t) width * height * depth * texel_size(format, type)))
+WRAP_VOID(glCompressedTexImage2D, (GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const void* data),
+          (target, level, internalFormat, width, height, border, imageSize, data),
+          if (data != NULL) { COUNT(textureUploads, 1); COUNT(textureBytes, imageSize); })
+WRAP_VOID(glCompressedTexSubImage2D, (GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, const void* data),
+          (target, level, x, y, width, height, format, imageSize, data),
+          COUNT(textureUploads, 1); COUNT(textureBytes, imageSize))
+
+WRAP_STALL_VOID(glFinish, (void), ())
+WRAP_STALL_VOID(glReadPixels, (GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void* pixels),
+                (x, y, width, height, format, type, pixels))
+WRAP_STALL_VOID(glGetTexImage, (GLenum target, GLint level, GLenum format, GLenum type, void* pixels), (target, level, format, type, pixels))
+WRAP_STALL_VOID(glGetBufferSubData, (GLenum target, GLintptr offset, GLsizeiptr size, void* data), (target, offset, size, data))
+
+static GLenum (*real_glClientWaitSync)(GLsync sync, GLbitfield flags, GLuint64 timeout);
+static GLenum wrap_glClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) {
+    int64_t start = telemetry_now_ns();
+    GLenum result = real_glClientWaitSync(sync, flags, timeout);
+    COUNT(stalls, 1);
+    COUNT(stallNs, telemetry_now_ns() - start);
+    return result;
+}
+
+// The GetProcAddress functions of the GL libraries, so that what LWJGL resolves through them is wrapped too
+static void* lookup(void* (*getProcAddress)(const char*), const char* name) {
+    return gl_profiler_wrap(name, getProcAddress(name));
+}
+
+static void* (*real_eglGetProcAddress)(const char* name);
+static void* (*real_OSMesaGetProcAddress)(const char* name);
+static void* (*real_glXGetProcAddress)(const char* name);
+static void* (*real_glXGetProcAddressARB)(const char* name);
+static void* wrap_eglGetProcAddress(const char* name) { return lookup(real_eglGetProcAddress, name); }
+static void* wrap_OSMesaGetProcAddress(const char* name) { return lookup(real_OSMesaGetProcAddress, name); }
+static void* wrap_glXGetProcAddress(const char* name) { return lookup(real_glXGetProcAddress, name); }
+static void* wrap_glXGetProcAddressARB(const char* name) { return lookup(real_glXGetProcAddressARB, name); }
+
+#define ENTRY(name) { #name, (void*) wrap_##name, (void**) &real_##name }
+
+static const struct {
+    const char* name;
+    void* wrapper;
+    void** real;
+} entries[] = {
+        ENTRY(glDrawArrays), ENTRY(glDrawElements), ENTRY(glDrawRangeElements), ENTRY(glDrawArraysInstanced),
+        ENTRY(glDrawElementsInstanced), ENTRY(glDrawElementsBaseVertex), ENTRY(glMultiDrawArrays), ENTRY(glMultiDrawElements),
+        ENTRY(glEnable), ENTRY(glDisable), ENTRY(glBlendFunc), ENTRY(glBlendFuncSeparate), ENTRY(glDepthFunc), ENTRY(glDepthMask),
+        ENTRY(glColorMask), ENTRY(glCullFace), ENTRY(glPolygonOffset), ENTRY(glViewport), ENTRY(glScissor), ENTRY(glUseProgram),
+        ENTRY(glActiveTexture), ENTRY(glBindTexture), ENTRY(glBindBuffer), ENTRY(glBindVertexArray), ENTRY(glBindFramebuffer),
+        ENTRY(glBufferData), ENTRY(glBufferSubData), ENTRY(glMapBufferRange),
+        ENTRY(glTexImage2D), ENTRY(glTexSubImage2D), ENTRY(glTexImage3D), ENTRY(glTexSubImage3D),
+        ENTRY(glCompressedTexImage2D), ENTRY(glCompressedTexSubImage2D),
+        ENTRY(glFinish), ENTRY(glReadPixels), ENTRY(glGetTexImage), ENTRY(glGetBufferSubData), ENTRY(glClientWaitSync),
+        ENTRY(eglGetProcAddress), ENTRY(OSMesaGetProcAddress), ENTRY(glXGetProcAddress), ENTRY(glXGetProcAddressARB)
+};
+
+bool gl_profiler_enabled() {
+    if (!envChecked) {
+        tracePath = getenv("POJAV_GL_TRACE");
+        if (tracePath != NULL && tracePath[0] == '\0') tracePath = NULL;
+        envChecked = true;
+    }
+    return tracePath != NULL;
+}
+
+void* gl_profiler_wrap(const char* name, void* proc) {
+    if (proc == NULL || name == NULL || !gl_profiler_enabled()) return proc;
+    for (size_t i = 0; i < sizeof(entries) / sizeof(entries[0]); i++) {
+        if (strcmp(entries[i].name, name) != 0) continue;
+        if (proc == entries[i].wrapper) return proc;
+        void* expected = NULL;
+        if (!atomic_compare_exchange_strong((_Atomic(void*)*) entries[i].real, &expected, proc) && expected != proc) {
+            LOG_TO_W("<%s> %s: %s", "GLProfiler", "Resolved to a second entry point, not profiling it", name);
+            return proc;
+        }
+        return entries[i].wrapper;
+    }
+    return proc;
+}
+
+void gl_profiler_on_frame() {
+    if (!gl_profiler_enabled()) return;
+    int64_t now = telemetry_now_ns();
+    if (traceFile == NULL) {
+        traceFile = fopen(tracePath, "w");
+        if (traceFile == NULL) {
+            LOG_TO_E("<%s> %s: %s", "GLProfiler", "Failed to open the trace file", tracePath);
+            tracePath = NULL;
+            return;
+        }
+        fputs("frame,frame_us,draws,state_changes,buffer_uploads,buffer_bytes,texture_uploads,texture_bytes,stalls,stall_us\n", traceFile);
+        LOG_TO_I("<%s> %s: %s", "GLProfiler", "Tracing GL calls to", tracePath);
+        lastFrameTime = now;
+    }
+    fprintf(traceFile, "%llu,%lld,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu\n",
+            (unsigned long long) frame++, (long long) (now - lastFrameTime) / 1000,
+            (unsigned long long) atomic_exchange(&counters.draws, 0),
+            (unsigned long long) atomic_exchange(&counters.stateChanges, 0),
+            (unsigned long long) atomic_exchange(&counters.bufferUploads, 0),
+            (unsigned long long) atomic_exchange(&counters.bufferBytes, 0),
+            (unsigned long long) atomic_exchange(&counters.textureUploads, 0),
+            (unsigned long long) atomic_exchange(&counters.textureBytes, 0),
+            (unsigned long long) atomic_exchange(&counters.stalls, 0),
+            (unsigned long long) atomic_exchange(&counters.stallNs, 0) / 1000);
+    lastFrameTime = now;
+    if (frame % FLUSH_INTERVAL_FRAMES == 0) fflush(traceFile);
+}
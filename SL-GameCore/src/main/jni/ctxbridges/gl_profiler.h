@@ -0,0 +1,22 @@
+//
+// GL call profiler (POJAV_GL_TRACE=<file>): the symbol loaders hand out counting wrappers instead of
+// the driver entry points, and every frame ends with a line of counters in the trace file:
+// draw calls, state changes, buffer and texture uploads with their sizes, and the time spent
+// waiting on the driver in glFinish and readbacks.
+// Covers the bridges' own lookups and those of LWJGL, through its dlsym().
+//
+
+#ifndef POJAVLAUNCHER_GL_PROFILER_H
+#define POJAVLAUNCHER_GL_PROFILER_H
+
+#include <stdbool.h>
+
+bool gl_profiler_enabled();
+
+/* Returns the wrapper of a resolved GL entry point, or proc itself if it isn't profiled */
+void* gl_profiler_wrap(const char* name, void* proc);
+
+/* Called by pojavSwapBuffers() to close the frame */
+void gl_profiler_on_frame();
+
+#endif //POJAVLAUNCHER_GL_PROFILER_H
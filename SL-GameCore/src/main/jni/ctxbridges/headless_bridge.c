@@ -0,0 +1,88 @@
+//
+// Headless OSMesa bridge, see headless_bridge.h
+//
+// Works like osm_bridge, with a buffer of the last known window size (or 720p) standing in
+// for the window: swapping only makes OSMesa finish the frame into it.
+//
+#include <malloc.h>
+#include <string.h>
+#include <environ/environ.h>
+#include <android/log.h>
+#include "headless_bridge.h"
+
+static const char* g_LogTag = "HeadlessBridge";
+static __thread headless_render_window_t* currentBundle;
+
+bool hl_init() {
+    dlsym_OSMesa();
+    return true;
+}
+
+headless_render_window_t* hl_get_current() {
+    return currentBundle;
+}
+
+headless_render_window_t* hl_init_context(headless_render_window_t* share) {
+    headless_render_window_t* bundle = malloc(sizeof(headless_render_window_t));
+    if(bundle == NULL) return NULL;
+    memset(bundle, 0, sizeof(headless_render_window_t));
+
+    int width = pojav_environ->savedWidth > 0 ? pojav_environ->savedWidth : HEADLESS_DEFAULT_WIDTH;
+    int height = pojav_environ->savedHeight > 0 ? pojav_environ->savedHeight : HEADLESS_DEFAULT_HEIGHT;
+    bundle->buffer.bits = malloc((size_t) width * height * 4);
+    if(bundle->buffer.bits == NULL) {
+        free(bundle);
+        return NULL;
+    }
+    bundle->buffer.width = width;
+    bundle->buffer.height = height;
+    bundle->buffer.stride = width;
+    bundle->buffer.format = WINDOW_FORMAT_RGBX_8888;
+
+    bundle->context = OSMesaCreateContext_p(GL_RGBA, share != NULL ? share->context : NULL);
+    if(bundle->context == NULL) {
+        free(bundle->buffer.bits);
+        free(bundle);
+        return NULL;
+    }
+    __android_log_print(ANDROID_LOG_INFO, g_LogTag, "Created a %dx%d headless context", width, height);
+    return bundle;
+}
+
+void hl_make_current(headless_render_window_t* bundle) {
+    if(bundle == NULL) {
+        //technically this does nothing as its not possible to unbind a context in OSMesa
+        OSMesaMakeCurrent_p(NULL, NULL, 0, 0, 0);
+        currentBundle = NULL;
+        return;
+    }
+    currentBundle = bundle;
+    if(pojav_environ->mainWindowBundle == NULL) {
+        pojav_environ->mainWindowBundle = (basic_render_window_t*) bundle;
+        __android_log_print(ANDROID_LOG_INFO, g_LogTag, "Main window bundle is now %p", pojav_environ->mainWindowBundle);
+    }
+    OSMesaMakeCurrent_p(bundle->context, bundle->buffer.bits, GL_UNSIGNED_BYTE, bundle->buffer.width, bundle->buffer.height);
+    OSMesaPixelStore_p(OSMESA_Y_UP, 0);
+}
+
+void hl_swap_buffers() {
+    // Nothing to post, but the frame has to be rendered for real to be measured
+    glFinish_p();
+}
+
+void hl_setup_window() {
+    // No window to change to
+}
+
+void hl_swap_interval(__attribute__((unused)) int swapInterval) {
+    // No display to sync to
+}
+
+void hl_destroy_context(headless_render_window_t* bundle) {
+    if(bundle == NULL) return;
+    if(currentBundle == bundle) hl_make_current(NULL);
+    if(pojav_environ->mainWindowBundle == (basic_render_window_t*) bundle) pojav_environ->mainWindowBundle = NULL;
+    OSMesaDestroyContext_p(bundle->context);
+    free(bundle->buffer.bits);
+    free(bundle);
+}
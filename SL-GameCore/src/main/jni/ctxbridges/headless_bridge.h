@@ -0,0 +1,31 @@
+//
+// Headless OSMesa bridge: renders into a malloc'd buffer instead of a window,
+// for benchmarking the bridge layer (and running the game) without any display or GPU.
+//
+#include <android/native_window.h>
+#include <stdbool.h>
+#ifndef POJAVLAUNCHER_HEADLESS_BRIDGE_H
+#define POJAVLAUNCHER_HEADLESS_BRIDGE_H
+#include "osmesa_loader.h"
+
+#define HEADLESS_DEFAULT_WIDTH 1280
+#define HEADLESS_DEFAULT_HEIGHT 720
+
+typedef struct {
+    char       state;
+    struct ANativeWindow *nativeSurface; // Always NULL, there is no window
+    struct ANativeWindow *newNativeSurface;
+    ANativeWindow_Buffer buffer; // Stands in for the locked window buffer, bits are malloc'd
+    OSMesaContext context;
+} headless_render_window_t;
+
+bool hl_init();
+headless_render_window_t* hl_get_current();
+headless_render_window_t* hl_init_context(headless_render_window_t* share);
+void hl_make_current(headless_render_window_t* bundle);
+void hl_swap_buffers();
+void hl_setup_window();
+void hl_swap_interval(int swapInterval);
+void hl_destroy_context(headless_render_window_t* bundle);
+
+#endif //POJAVLAUNCHER_HEADLESS_BRIDGE_H
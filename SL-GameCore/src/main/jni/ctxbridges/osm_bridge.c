@@ -3,9 +3,15 @@
 //
 #include <malloc.h>
 #include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
 #include <environ/environ.h>
 #include <android/log.h>
 #include "osm_bridge.h"
+#include "render_scale.h"
+#include "pixel_kernels.h"
+#include "telemetry/histogram.h"
+#include "telemetry/surface_swap.h"
 
 static const char* g_LogTag = "GLBridge";
 static __thread osm_render_window_t* currentBundle;
@@ -15,9 +21,272 @@ static bool hasSetNoRendererBuffer = false;
 
 // Its not in a .h file because it is not supposed to be used outsife of this file.
 void setNativeWindowSwapInterval(struct ANativeWindow* nativeWindow, int swapInterval);
+void osm_release_window();
+void osm_set_no_render_buffer(ANativeWindow_Buffer* buffer);
+
+// Async present (POJAV_OSM_ASYNC_PRESENT=1): the main window renders into private frame buffers,
+// a present thread copies each finished frame into a locked window buffer and posts it,
+// while the game already renders the next one. The frames are presented in order, the render
+// thread only waits when all the buffers are taken.
+// RGB565 present (POJAV_OSM_RGB565=1) halves the bytes written to the window: the frame is still
+// rendered as RGBA into a private buffer and converted while it is copied, on the present thread
+// if there is one, on the render thread otherwise. POJAV_OSM_RGB565_DITHER=1 adds an ordered dither.
+// Damage tracking (POJAV_OSM_DAMAGE=1) hashes the frame tile by tile and only locks and copies the
+// bounding box of the tiles that changed since the last frame. A static screen copies nothing, but
+// still locks and posts a buffer with an empty dirty rect, so the buffer queue keeps its pacing.
+#define PRESENT_MAX_SLOTS 3
+#define DAMAGE_TILE_SIZE 32
+static struct {
+    bool enabled;
+    bool threaded;
+    bool rgb565, dither;
+    bool damage;
+    int slotCount;
+    bool started;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    ANativeWindow* window; // Only changes while the present thread is idle
+    int32_t width, height;
+    void* slots[PRESENT_MAX_SLOTS];
+    int renderSlot; // Render thread only
+    int queue[PRESENT_MAX_SLOTS]; // Finished frames, oldest first
+    int queueHead, queueCount;
+    unsigned int freeSlots;
+    bool busy; // Posting a frame right now
+    bool failed; // The window couldn't be locked or posted, the render thread has to let it go
+    uint64_t* tileHashes; // Of the last presented frame, only touched while posting
+    uint64_t* nextTileHashes;
+    bool tileHashesValid;
+} present = { .lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER, .renderSlot = -1 };
+
+static bool osm_present_private(osm_render_window_t* bundle) {
+    return present.enabled && bundle == (osm_render_window_t*) pojav_environ->mainWindowBundle;
+}
+
+/** Find the bounding box of the tiles that changed since the last presented frame, empty if none did */
+static void osm_present_damage(const uint32_t* frame, ARect* dirty) {
+    int tilesX = (present.width + DAMAGE_TILE_SIZE - 1) / DAMAGE_TILE_SIZE;
+    int tilesY = (present.height + DAMAGE_TILE_SIZE - 1) / DAMAGE_TILE_SIZE;
+    pk_hash_tiles(present.nextTileHashes, frame, present.width, present.width, present.height, DAMAGE_TILE_SIZE);
+    uint64_t* hashes = present.nextTileHashes;
+    present.nextTileHashes = present.tileHashes;
+    present.tileHashes = hashes;
+    if (!present.tileHashesValid) {
+        present.tileHashesValid = true;
+        return; // Everything is dirty
+    }
+    int left = tilesX, top = tilesY, right = -1, bottom = -1;
+    for (int y = 0; y < tilesY; y++) {
+        for (int x = 0; x < tilesX; x++) {
+            if (hashes[y * tilesX + x] == present.nextTileHashes[y * tilesX + x]) continue;
+            if (x < left) left = x;
+            if (x > right) right = x;
+            if (y < top) top = y;
+            bottom = y;
+        }
+    }
+    if (right < 0) {
+        *dirty = (ARect) { 0, 0, 0, 0 };
+        return;
+    }
+    // One more pixel around it, the sharpening filter reads the neighbours
+    dirty->left = left * DAMAGE_TILE_SIZE > 0 ? left * DAMAGE_TILE_SIZE - 1 : 0;
+    dirty->top = top * DAMAGE_TILE_SIZE > 0 ? top * DAMAGE_TILE_SIZE - 1 : 0;
+    dirty->right = (right + 1) * DAMAGE_TILE_SIZE + 1 < present.width ? (right + 1) * DAMAGE_TILE_SIZE + 1 : present.width;
+    dirty->bottom = (bottom + 1) * DAMAGE_TILE_SIZE + 1 < present.height ? (bottom + 1) * DAMAGE_TILE_SIZE + 1 : present.height;
+}
+
+/** Copy a finished frame into the window and post it, returns false if the window is gone */
+static bool osm_present_post(int slot) {
+    ANativeWindow_Buffer windowBuffer;
+    ANativeWindow_Buffer frame = {
+            .width = present.width, .height = present.height, .stride = present.width,
+            .format = WINDOW_FORMAT_RGBX_8888, .bits = present.slots[slot]
+    };
+    ARect dirty = { 0, 0, present.width, present.height };
+    if (present.damage) osm_present_damage(frame.bits, &dirty);
+    // The window may grow the dirty rect, when it can't copy the rest from the previous buffer
+    if (ANativeWindow_lock(present.window, &windowBuffer, present.damage ? &dirty : NULL) != 0) return false;
+    render_scale_sharpen(&frame);
+    // Keep the rect on the 4x4 dither grid of the full frame
+    int32_t left = dirty.left & ~3, top = dirty.top & ~3;
+    int32_t right = dirty.right < present.width ? dirty.right : present.width;
+    int32_t bottom = dirty.bottom < present.height ? dirty.bottom : present.height;
+    if (right > windowBuffer.width) right = windowBuffer.width;
+    if (bottom > windowBuffer.height) bottom = windowBuffer.height;
+    if (right > left && bottom > top) {
+        const uint32_t* src = (const uint32_t*) frame.bits + (size_t) top * frame.stride + left;
+        size_t dstOffset = (size_t) top * windowBuffer.stride + left;
+        if (windowBuffer.format == WINDOW_FORMAT_RGB_565) {
+            if (present.dither) pk_rgba_to_rgb565_dither((uint16_t*) windowBuffer.bits + dstOffset, windowBuffer.stride, src, frame.stride, right - left, bottom - top, false);
+            else pk_rgba_to_rgb565((uint16_t*) windowBuffer.bits + dstOffset, windowBuffer.stride, src, frame.stride, right - left, bottom - top, false);
+        } else {
+            pk_copy_rgba_to_rgbx((uint32_t*) windowBuffer.bits + dstOffset, windowBuffer.stride, src, frame.stride, right - left, bottom - top, false);
+        }
+    }
+    return ANativeWindow_unlockAndPost(present.window) == 0;
+}
+
+static void* osm_present_thread(__attribute__((unused)) void* arg) {
+    pthread_mutex_lock(&present.lock);
+    while (true) {
+        while (present.queueCount == 0) pthread_cond_wait(&present.cond, &present.lock);
+        int slot = present.queue[present.queueHead];
+        present.queueHead = (present.queueHead + 1) % PRESENT_MAX_SLOTS;
+        present.queueCount--;
+        present.busy = true;
+        pthread_mutex_unlock(&present.lock);
+
+        bool failed = !osm_present_post(slot);
+
+        pthread_mutex_lock(&present.lock);
+        if (failed) present.failed = true;
+        present.busy = false;
+        present.freeSlots |= 1u << slot;
+        pthread_cond_broadcast(&present.cond);
+    }
+    return NULL;
+}
+
+/** Wait until every finished frame has been posted, so that the window can be changed */
+static void osm_present_wait_idle() {
+    pthread_mutex_lock(&present.lock);
+    while (present.queueCount > 0 || present.busy) pthread_cond_wait(&present.cond, &present.lock);
+    pthread_mutex_unlock(&present.lock);
+}
+
+static void osm_present_use_slot(osm_render_window_t* bundle, int slot) {
+    present.renderSlot = slot;
+    bundle->buffer.bits = present.slots[slot];
+    bundle->buffer.width = present.width;
+    bundle->buffer.height = present.height;
+    bundle->buffer.stride = present.width;
+}
+
+/** Go back to rendering straight into the window, in the format it expects */
+static void osm_present_disable(osm_render_window_t* bundle) {
+    present.enabled = false;
+    present.renderSlot = -1;
+    osm_set_no_render_buffer(&bundle->buffer);
+    if (present.rgb565) render_scale_set_geometry(bundle->nativeSurface, WINDOW_FORMAT_RGBX_8888);
+}
+
+/** Make the main window render into a private frame buffer sized for its current window */
+static void osm_present_prepare(osm_render_window_t* bundle) {
+    int32_t width = ANativeWindow_getWidth(bundle->nativeSurface);
+    int32_t height = ANativeWindow_getHeight(bundle->nativeSurface);
+    osm_present_wait_idle();
+    present.window = bundle->nativeSurface;
+    if (width != present.width || height != present.height || present.renderSlot < 0) {
+        for (int i = 0; i < present.slotCount; i++) {
+            free(present.slots[i]);
+            present.slots[i] = calloc((size_t) width * height, 4);
+            if (present.slots[i] == NULL) {
+                __android_log_print(ANDROID_LOG_ERROR, g_LogTag, "Out of memory for the present buffers, presenting directly");
+                osm_present_disable(bundle);
+                return;
+            }
+        }
+        present.width = width;
+        present.height = height;
+        if (present.damage) {
+            size_t tiles = (size_t) ((width + DAMAGE_TILE_SIZE - 1) / DAMAGE_TILE_SIZE) * ((height + DAMAGE_TILE_SIZE - 1) / DAMAGE_TILE_SIZE);
+            free(present.tileHashes);
+            free(present.nextTileHashes);
+            present.tileHashes = malloc(tiles * sizeof(uint64_t));
+            present.nextTileHashes = malloc(tiles * sizeof(uint64_t));
+            if (present.tileHashes == NULL || present.nextTileHashes == NULL) {
+                __android_log_print(ANDROID_LOG_ERROR, g_LogTag, "Out of memory for the damage tiles, presenting whole frames");
+                present.damage = false;
+            }
+        }
+        pthread_mutex_lock(&present.lock);
+        present.freeSlots = ((1u << present.slotCount) - 1) & ~1u;
+        pthread_mutex_unlock(&present.lock);
+        osm_present_use_slot(bundle, 0);
+    }
+    if (present.threaded && !present.started) {
+        if (pthread_create(&present.thread, NULL, osm_present_thread, NULL) != 0) {
+            __android_log_print(ANDROID_LOG_ERROR, g_LogTag, "Failed to start the present thread, presenting synchronously");
+            present.threaded = false;
+            if (!present.rgb565 && !present.damage) {
+                osm_present_disable(bundle);
+                return;
+            }
+        } else {
+            pthread_setname_np(present.thread, "OSMPresent");
+            pthread_detach(present.thread);
+            present.started = true;
+        }
+    }
+    // A new window has none of the previous frames
+    present.tileHashesValid = false;
+    osm_present_use_slot(bundle, present.renderSlot);
+}
+
+/**
+ * The window buffers change size without a new window: render scale changes and in place resizes.
+ * Resize the frame buffers with them, so that the next frames are neither cropped nor padded.
+ */
+static void osm_present_follow_size(osm_render_window_t* bundle) {
+    if (ANativeWindow_getWidth(present.window) == present.width && ANativeWindow_getHeight(present.window) == present.height) return;
+    // Waits for the frames still queued at the old size
+    osm_present_prepare(bundle);
+}
+
+/** Hand the finished frame to the present thread and move on to a free frame buffer, or present it right here */
+static void osm_present_submit(osm_render_window_t* bundle) {
+    if (!present.threaded) {
+        if (!osm_present_post(present.renderSlot)) {
+            osm_release_window();
+            return;
+        }
+        osm_present_follow_size(bundle);
+        return;
+    }
+    pthread_mutex_lock(&present.lock);
+    present.queue[(present.queueHead + present.queueCount) % PRESENT_MAX_SLOTS] = present.renderSlot;
+    present.queueCount++;
+    pthread_cond_broadcast(&present.cond);
+    while (present.freeSlots == 0) pthread_cond_wait(&present.cond, &present.lock);
+    int slot = __builtin_ctz(present.freeSlots);
+    present.freeSlots &= ~(1u << slot);
+    bool failed = present.failed;
+    present.failed = false;
+    pthread_mutex_unlock(&present.lock);
+    osm_present_use_slot(bundle, slot);
+
+    if (failed) {
+        osm_present_wait_idle();
+        osm_release_window();
+        return;
+    }
+    osm_present_follow_size(bundle);
+}
 
 bool osm_init() {
     dlsym_OSMesa();
+    const char* asyncPresent = getenv("POJAV_OSM_ASYNC_PRESENT");
+    const char* rgb565 = getenv("POJAV_OSM_RGB565");
+    const char* dither = getenv("POJAV_OSM_RGB565_DITHER");
+    const char* damage = getenv("POJAV_OSM_DAMAGE");
+    present.threaded = asyncPresent != NULL && !strcmp(asyncPresent, "1");
+    present.rgb565 = rgb565 != NULL && !strcmp(rgb565, "1");
+    present.dither = present.rgb565 && dither != NULL && !strcmp(dither, "1");
+    present.damage = damage != NULL && !strcmp(damage, "1");
+    present.enabled = present.threaded || present.rgb565 || present.damage;
+    present.slotCount = 1;
+    if (present.threaded) {
+        const char* slots = getenv("POJAV_OSM_PRESENT_BUFFERS");
+        present.slotCount = slots != NULL ? atoi(slots) : PRESENT_MAX_SLOTS;
+        if (present.slotCount < 2 || present.slotCount > PRESENT_MAX_SLOTS) present.slotCount = PRESENT_MAX_SLOTS;
+        __android_log_print(ANDROID_LOG_INFO, g_LogTag, "Presenting asynchronously with %d buffers", present.slotCount);
+    }
+    if (present.rgb565)
+        __android_log_print(ANDROID_LOG_INFO, g_LogTag, "Presenting in RGB565%s", present.dither ? " with dithering" : "");
+    if (present.damage)
+        __android_log_print(ANDROID_LOG_INFO, g_LogTag, "Presenting only the damaged region");
     return true; // no more specific initialization required
 }
 
@@ -49,7 +318,8 @@ void osm_set_no_render_buffer(ANativeWindow_Buffer* buffer) {
 
 void osm_swap_surfaces(osm_render_window_t* bundle) {
     if(bundle->nativeSurface != NULL && bundle->newNativeSurface != bundle->nativeSurface) {
-        if(!bundle->disable_rendering) {
+        // The present thread locks the window itself, and only for as long as it posts
+        if(!bundle->disable_rendering && !osm_present_private(bundle)) {
             __android_log_print(ANDROID_LOG_INFO, g_LogTag, "Unlocking for cleanup...");
             ANativeWindow_unlockAndPost(bundle->nativeSurface);
         }
@@ -60,7 +330,8 @@ void osm_swap_surfaces(osm_render_window_t* bundle) {
         bundle->nativeSurface = bundle->newNativeSurface;
         bundle->newNativeSurface = NULL;
         ANativeWindow_acquire(bundle->nativeSurface);
-        ANativeWindow_setBuffersGeometry(bundle->nativeSurface, 0, 0, WINDOW_FORMAT_RGBX_8888);
+        // Only the main window goes through the converting copy, the others are rendered into directly
+        render_scale_set_geometry(bundle->nativeSurface, present.rgb565 && osm_present_private(bundle) ? WINDOW_FORMAT_RGB_565 : WINDOW_FORMAT_RGBX_8888);
         bundle->disable_rendering = false;
         return;
     }else {
@@ -111,14 +382,28 @@ void osm_make_current(osm_render_window_t* bundle) {
         osm_set_no_render_buffer(&bundle->buffer);
         hasSetNoRendererBuffer = true;
     }
+    if(osm_present_private(bundle) && bundle->nativeSurface != NULL && !bundle->disable_rendering)
+        osm_present_prepare(bundle);
     osm_apply_current_ll();
     OSMesaPixelStore_p(OSMESA_Y_UP,0);
 }
 
 void osm_swap_buffers() {
     if(currentBundle->state == STATE_RENDERER_NEW_WINDOW) {
+        int64_t start = telemetry_now_ns();
+        if(osm_present_private(currentBundle)) osm_present_wait_idle();
         osm_swap_surfaces(currentBundle);
+        if(osm_present_private(currentBundle) && currentBundle->nativeSurface != NULL && !currentBundle->disable_rendering)
+            osm_present_prepare(currentBundle);
         currentBundle->state = STATE_RENDERER_ALIVE;
+        surface_swap_record(telemetry_now_ns() - start, false);
+    }
+
+    if(osm_present_private(currentBundle) && currentBundle->nativeSurface != NULL && !currentBundle->disable_rendering) {
+        glFinish_p(); // this will force osmesa to write the last rendered image into the frame buffer
+        osm_present_submit(currentBundle);
+        osm_apply_current_ll();
+        return;
     }
 
     if(currentBundle->nativeSurface != NULL && !currentBundle->disable_rendering)
@@ -128,6 +413,9 @@ void osm_swap_buffers() {
     osm_apply_current_ll();
     glFinish_p(); // this will force osmesa to write the last rendered image into the buffer
 
+    if(currentBundle->nativeSurface != NULL && !currentBundle->disable_rendering)
+        render_scale_sharpen(&currentBundle->buffer);
+
     if(currentBundle->nativeSurface != NULL && !currentBundle->disable_rendering)
         if(ANativeWindow_unlockAndPost(currentBundle->nativeSurface) != 0)
             osm_release_window();
@@ -40,7 +40,7 @@ char* construct_main_path(const char* mesa_name, const char* pojav_native_dir) {
 }
 
 void dlsym_OSMesa() {
-    if (!is_renderer_vulkan()) return;
+    if (!is_renderer_vulkan() && pojav_environ->config_renderer != RENDERER_HEADLESS) return;
 
     char* mesa_name = getenv("LIB_MESA_NAME");
     char* pojav_native_dir = getenv("POJAV_NATIVEDIR");
@@ -22,5 +22,6 @@ extern void (*glReadPixels_p) (GLint x, GLint y, GLsizei width, GLsizei height,
 extern void (*glReadBuffer_p) (GLenum mode);
 extern void* (*OSMesaGetProcAddress_p)(const char* funcName);
 
+char* construct_main_path(const char* mesa_name, const char* pojav_native_dir);
 void dlsym_OSMesa();
 #endif //POJAVLAUNCHER_OSMESA_LOADER_H
@@ -0,0 +1,245 @@
+//
+// Pixel kernels, see pixel_kernels.h
+//
+// Each kernel works row by row: a vector loop over the bulk of the row and a scalar loop
+// for the rest, so no alignment or width requirement is put on the callers.
+// AVX isn't part of the Android x86_64 ABI, SSE2 is the widest x86 baseline there.
+//
+
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "pixel_kernels.h"
+
+#define SOURCE_ROW(src, srcStride, y, height, flip) ((src) + (size_t) ((flip) ? (height) - 1 - (y) : (y)) * (srcStride))
+
+static inline uint16_t rgba_to_rgb565(uint32_t pixel) {
+    return (uint16_t) ((pixel & 0xF8) << 8 | (pixel & 0xFC00) >> 5 | (pixel & 0xF80000) >> 19);
+}
+
+/* 4x4 Bayer matrix, 0-15 */
+static const uint8_t bayer[4][4] = {
+        { 0, 8, 2, 10 },
+        { 12, 4, 14, 6 },
+        { 3, 11, 1, 9 },
+        { 15, 7, 13, 5 }
+};
+
+/* What to add to each channel before truncating it: up to one step of 8 for R and B, of 4 for G */
+static inline uint32_t dither_offset(int x, int y) {
+    uint32_t level = bayer[y & 3][x & 3];
+    return level >> 1 | (level >> 2) << 8 | (level >> 1) << 16;
+}
+
+static inline uint32_t add_saturated(uint32_t pixel, uint32_t offset) {
+    uint32_t result = 0;
+    for (int shift = 0; shift < 24; shift += 8) {
+        uint32_t value = (pixel >> shift & 0xFF) + (offset >> shift & 0xFF);
+        result |= (value > 0xFF ? 0xFF : value) << shift;
+    }
+    return result;
+}
+
+static inline uint32_t swap_rb(uint32_t pixel) {
+    return (pixel & 0xFF00FF00) | (pixel & 0xFF) << 16 | (pixel >> 16 & 0xFF);
+}
+
+static void copy_row_rgbx(uint32_t* dst, const uint32_t* src, int width) {
+    int x = 0;
+#if defined(__ARM_NEON)
+    const uint32x4_t opaque = vdupq_n_u32(0xFF000000);
+    for (; x + 16 <= width; x += 16) {
+        uint32x4x4_t pixels = vld1q_u32_x4(src + x);
+        pixels.val[0] = vorrq_u32(pixels.val[0], opaque);
+        pixels.val[1] = vorrq_u32(pixels.val[1], opaque);
+        pixels.val[2] = vorrq_u32(pixels.val[2], opaque);
+        pixels.val[3] = vorrq_u32(pixels.val[3], opaque);
+        vst1q_u32_x4(dst + x, pixels);
+    }
+#elif defined(__SSE2__)
+    const __m128i opaque = _mm_set1_epi32((int) 0xFF000000);
+    for (; x + 8 <= width; x += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i*) (src + x));
+        __m128i b = _mm_loadu_si128((const __m128i*) (src + x + 4));
+        _mm_storeu_si128((__m128i*) (dst + x), _mm_or_si128(a, opaque));
+        _mm_storeu_si128((__m128i*) (dst + x + 4), _mm_or_si128(b, opaque));
+    }
+#endif
+    for (; x < width; x++) dst[x] = src[x] | 0xFF000000;
+}
+
+static void rgb565_row(uint16_t* dst, const uint32_t* src, int width) {
+    int x = 0;
+#if defined(__ARM_NEON)
+    for (; x + 8 <= width; x += 8) {
+        uint8x8x4_t pixels = vld4_u8((const uint8_t*) (src + x));
+        // Shift each channel to the top of 16 bits, then insert the next one below what it keeps
+        uint16x8_t result = vshll_n_u8(pixels.val[0], 8);
+        result = vsriq_n_u16(result, vshll_n_u8(pixels.val[1], 8), 5);
+        result = vsriq_n_u16(result, vshll_n_u8(pixels.val[2], 8), 11);
+        vst1q_u16(dst + x, result);
+    }
+#elif defined(__SSE2__)
+    const __m128i redMask = _mm_set1_epi32(0xF8), greenMask = _mm_set1_epi32(0xFC00), blueMask = _mm_set1_epi32(0xF80000);
+    const __m128i bias32 = _mm_set1_epi32(0x8000), bias16 = _mm_set1_epi16((short) 0x8000);
+    for (; x + 8 <= width; x += 8) {
+        __m128i packed[2];
+        for (int half = 0; half < 2; half++) {
+            __m128i p = _mm_loadu_si128((const __m128i*) (src + x + half * 4));
+            __m128i value = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(p, redMask), 8),
+                            _mm_or_si128(_mm_srli_epi32(_mm_and_si128(p, greenMask), 5),
+                                         _mm_srli_epi32(_mm_and_si128(p, blueMask), 19)));
+            // SSE2 only packs with signed saturation, move the values into its range and back
+            packed[half] = _mm_sub_epi32(value, bias32);
+        }
+        _mm_storeu_si128((__m128i*) (dst + x), _mm_add_epi16(_mm_packs_epi32(packed[0], packed[1]), bias16));
+    }
+#endif
+    for (; x < width; x++) dst[x] = rgba_to_rgb565(src[x]);
+}
+
+static void rgb565_dither_row(uint16_t* dst, const uint32_t* src, int width, int y) {
+    uint32_t offsets[8];
+    for (int i = 0; i < 8; i++) offsets[i] = dither_offset(i, y);
+    int x = 0;
+#if defined(__ARM_NEON)
+    uint8x8x4_t threshold = vld4_u8((const uint8_t*) offsets);
+    for (; x + 8 <= width; x += 8) {
+        uint8x8x4_t pixels = vld4_u8((const uint8_t*) (src + x));
+        uint16x8_t result = vshll_n_u8(vqadd_u8(pixels.val[0], threshold.val[0]), 8);
+        result = vsriq_n_u16(result, vshll_n_u8(vqadd_u8(pixels.val[1], threshold.val[1]), 8), 5);
+        result = vsriq_n_u16(result, vshll_n_u8(vqadd_u8(pixels.val[2], threshold.val[2]), 8), 11);
+        vst1q_u16(dst + x, result);
+    }
+#elif defined(__SSE2__)
+    const __m128i redMask = _mm_set1_epi32(0xF8), greenMask = _mm_set1_epi32(0xFC00), blueMask = _mm_set1_epi32(0xF80000);
+    const __m128i bias32 = _mm_set1_epi32(0x8000), bias16 = _mm_set1_epi16((short) 0x8000);
+    // The pattern repeats every 4 pixels, which is exactly one vector
+    const __m128i threshold = _mm_loadu_si128((const __m128i*) offsets);
+    for (; x + 8 <= width; x += 8) {
+        __m128i packed[2];
+        for (int half = 0; half < 2; half++) {
+            __m128i p = _mm_adds_epu8(_mm_loadu_si128((const __m128i*) (src + x + half * 4)), threshold);
+            __m128i value = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(p, redMask), 8),
+                            _mm_or_si128(_mm_srli_epi32(_mm_and_si128(p, greenMask), 5),
+                                         _mm_srli_epi32(_mm_and_si128(p, blueMask), 19)));
+            packed[half] = _mm_sub_epi32(value, bias32);
+        }
+        _mm_storeu_si128((__m128i*) (dst + x), _mm_add_epi16(_mm_packs_epi32(packed[0], packed[1]), bias16));
+    }
+#endif
+    for (; x < width; x++) dst[x] = rgba_to_rgb565(add_saturated(src[x], offsets[x & 3]));
+}
+
+static void swizzle_row(uint32_t* dst, const uint32_t* src, int width) {
+    int x = 0;
+#if defined(__ARM_NEON)
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x4_t pixels = vld4q_u8((const uint8_t*) (src + x));
+        uint8x16_t red = pixels.val[0];
+        pixels.val[0] = pixels.val[2];
+        pixels.val[2] = red;
+        vst4q_u8((uint8_t*) (dst + x), pixels);
+    }
+#elif defined(__SSE2__)
+    const __m128i keep = _mm_set1_epi32((int) 0xFF00FF00), low = _mm_set1_epi32(0xFF);
+    for (; x + 4 <= width; x += 4) {
+        __m128i p = _mm_loadu_si128((const __m128i*) (src + x));
+        __m128i result = _mm_or_si128(_mm_and_si128(p, keep),
+                         _mm_or_si128(_mm_slli_epi32(_mm_and_si128(p, low), 16),
+                                      _mm_and_si128(_mm_srli_epi32(p, 16), low)));
+        _mm_storeu_si128((__m128i*) (dst + x), result);
+    }
+#endif
+    for (; x < width; x++) dst[x] = swap_rb(src[x]);
+}
+
+/*
+ * Feed a tile row into 4 interleaved lanes of two running hashes, pixel i going to lane i % 4:
+ * a = a * 33 + pixel, b = rotl(b, 7) ^ pixel
+ */
+static void hash_row(uint32_t* a, uint32_t* b, const uint32_t* src, int width) {
+    int x = 0;
+#if defined(__ARM_NEON)
+    uint32x4_t va = vld1q_u32(a), vb = vld1q_u32(b);
+    for (; x + 4 <= width; x += 4) {
+        uint32x4_t pixels = vld1q_u32(src + x);
+        va = vaddq_u32(vaddq_u32(vshlq_n_u32(va, 5), va), pixels);
+        vb = veorq_u32(vsriq_n_u32(vshlq_n_u32(vb, 7), vb, 25), pixels);
+    }
+    vst1q_u32(a, va);
+    vst1q_u32(b, vb);
+#elif defined(__SSE2__)
+    __m128i va = _mm_loadu_si128((const __m128i*) a), vb = _mm_loadu_si128((const __m128i*) b);
+    for (; x + 4 <= width; x += 4) {
+        __m128i pixels = _mm_loadu_si128((const __m128i*) (src + x));
+        va = _mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(va, 5), va), pixels);
+        vb = _mm_xor_si128(_mm_or_si128(_mm_slli_epi32(vb, 7), _mm_srli_epi32(vb, 25)), pixels);
+    }
+    _mm_storeu_si128((__m128i*) a, va);
+    _mm_storeu_si128((__m128i*) b, vb);
+#endif
+    for (; x < width; x++) {
+        int lane = x & 3;
+        a[lane] = a[lane] * 33 + src[x];
+        b[lane] = (b[lane] << 7 | b[lane] >> 25) ^ src[x];
+    }
+}
+
+void pk_copy_rgba_to_rgbx(uint32_t* dst, size_t dstStride, const uint32_t* src, size_t srcStride, int width, int height, bool flip) {
+    for (int y = 0; y < height; y++)
+        copy_row_rgbx(dst + (size_t) y * dstStride, SOURCE_ROW(src, srcStride, y, height, flip), width);
+}
+
+void pk_rgba_to_rgb565(uint16_t* dst, size_t dstStride, const uint32_t* src, size_t srcStride, int width, int height, bool flip) {
+    for (int y = 0; y < height; y++)
+        rgb565_row(dst + (size_t) y * dstStride, SOURCE_ROW(src, srcStride, y, height, flip), width);
+}
+
+void pk_rgba_to_rgb565_dither(uint16_t* dst, size_t dstStride, const uint32_t* src, size_t srcStride, int width, int height, bool flip) {
+    for (int y = 0; y < height; y++)
+        rgb565_dither_row(dst + (size_t) y * dstStride, SOURCE_ROW(src, srcStride, y, height, flip), width, y);
+}
+
+void pk_swizzle_rb(uint32_t* dst, size_t dstStride, const uint32_t* src, size_t srcStride, int width, int height, bool flip) {
+    for (int y = 0; y < height; y++)
+        swizzle_row(dst + (size_t) y * dstStride, SOURCE_ROW(src, srcStride, y, height, flip), width);
+}
+
+void pk_hash_tiles(uint64_t* hashes, const uint32_t* src, size_t srcStride, int width, int height, int tileSize) {
+    int tilesX = (width + tileSize - 1) / tileSize;
+    for (int tileY = 0; tileY * tileSize < height; tileY++) {
+        int rows = height - tileY * tileSize < tileSize ? height - tileY * tileSize : tileSize;
+        for (int tileX = 0; tileX < tilesX; tileX++) {
+            int columns = width - tileX * tileSize < tileSize ? width - tileX * tileSize : tileSize;
+            uint32_t a[4] = { 5381, 5381, 5381, 5381 }, b[4] = { 0 };
+            const uint32_t* tile = src + (size_t) tileY * tileSize * srcStride + (size_t) tileX * tileSize;
+            for (int y = 0; y < rows; y++) hash_row(a, b, tile + (size_t) y * srcStride, columns);
+            // FNV-1a over the lanes
+            uint64_t hash = 14695981039346656037ull;
+            for (int lane = 0; lane < 4; lane++)
+                hash = (hash ^ ((uint64_t) b[lane] << 32 | a[lane])) * 1099511628211ull;
+            hashes[(size_t) tileY * tilesX + tileX] = hash;
+        }
+    }
+}
+
+void pk_flip_vertical(uint32_t* pixels, size_t stride, int width, int height) {
+    // memcpy is already as wide as it gets, only the row buffer is needed
+    uint32_t row[1024];
+    for (int y = 0; y < height / 2; y++) {
+        uint32_t* top = pixels + (size_t) y * stride;
+        uint32_t* bottom = pixels + (size_t) (height - 1 - y) * stride;
+        for (int x = 0; x < width; x += 1024) {
+            size_t bytes = (size_t) (width - x < 1024 ? width - x : 1024) * sizeof(uint32_t);
+            memcpy(row, top + x, bytes);
+            memcpy(top + x, bottom + x, bytes);
+            memcpy(bottom + x, row, bytes);
+        }
+    }
+}
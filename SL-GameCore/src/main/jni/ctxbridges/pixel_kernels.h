@@ -0,0 +1,40 @@
+//
+// Pixel kernels for the software presentation paths: copying frames into window buffers,
+// with optional vertical flip and conversion. Vectorized with NEON on ARM and SSE2 on x86,
+// with a scalar fallback elsewhere.
+//
+// Strides are in pixels, like ANativeWindow_Buffer.stride. Pixels are 32-bit RGBA
+// (R in the lowest byte, as GL_RGBA/GL_UNSIGNED_BYTE and WINDOW_FORMAT_RGBX_8888 lay them out)
+// unless said otherwise. With flip, the last source row ends up first.
+//
+
+#ifndef POJAVLAUNCHER_PIXEL_KERNELS_H
+#define POJAVLAUNCHER_PIXEL_KERNELS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Copy RGBA into an RGBX buffer, the X byte is set to 0xFF so that it's opaque even as RGBA */
+void pk_copy_rgba_to_rgbx(uint32_t* dst, size_t dstStride, const uint32_t* src, size_t srcStride, int width, int height, bool flip);
+
+/* Convert RGBA into RGB565, the alpha is dropped */
+void pk_rgba_to_rgb565(uint16_t* dst, size_t dstStride, const uint32_t* src, size_t srcStride, int width, int height, bool flip);
+
+/* Same, with a 4x4 ordered dither that hides the banding of the 5 and 6 bit channels */
+void pk_rgba_to_rgb565_dither(uint16_t* dst, size_t dstStride, const uint32_t* src, size_t srcStride, int width, int height, bool flip);
+
+/* Swap the R and B channels, BGRA <-> RGBA. dst may be src, as long as flip isn't set */
+void pk_swizzle_rb(uint32_t* dst, size_t dstStride, const uint32_t* src, size_t srcStride, int width, int height, bool flip);
+
+/* Flip 32-bit pixels vertically in place */
+void pk_flip_vertical(uint32_t* pixels, size_t stride, int width, int height);
+
+/*
+ * Hash the 32-bit pixels tile by tile, to find out what changed between two frames.
+ * hashes gets one entry per tile, row by row: (width + tileSize - 1) / tileSize per row,
+ * the tiles of the last row and column are cut to the frame.
+ */
+void pk_hash_tiles(uint64_t* hashes, const uint32_t* src, size_t srcStride, int width, int height, int tileSize);
+
+#endif //POJAVLAUNCHER_PIXEL_KERNELS_H
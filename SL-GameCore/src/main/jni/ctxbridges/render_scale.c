@@ -0,0 +1,227 @@
+//
+// Render scale, see render_scale.h
+//
+// The buffer geometry only changes on the render thread, right before a present: the new size
+// applies from the next dequeued buffer on, and the game learns about it on its next event pump,
+// so it renders that frame at the new size.
+//
+// The controller works in steps of the scale: it lowers it as soon as the frame rate falls short
+// of the target and probes one step up after a while at the target. Every fall doubles the wait
+// before the next probe, so a scale that can't be held isn't retried every other second.
+//
+
+#include <jni.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+
+#include <environ/environ.h>
+#include "logger/logger.h"
+#include "telemetry/histogram.h"
+#include "render_scale.h"
+
+#define CONTROL_WINDOW_NS 500000000LL
+#define SCALE_STEP 0.05f
+#define FALL_BELOW 92 // Lower the scale below this much (%) of the target frame rate
+#define HOLD_ABOVE 98 // A window counts as holding the target from this much (%) of it on
+#define PROBE_WINDOWS_MIN 4
+#define PROBE_WINDOWS_MAX 64
+
+static struct {
+    _Atomic float scale;
+    atomic_int targetFps;
+    _Atomic float minScale;
+    _Atomic float sharpness;
+} config = { 1.0f, 0, 0.5f, 0.0f };
+
+static _Atomic float currentScale = 1.0f;
+static bool envChecked;
+
+/* Render thread only */
+static ANativeWindow* appliedWindow;
+static int appliedWidth, appliedHeight;
+static float appliedScale = 1.0f;
+static atomic_bool resizePending;
+static int64_t windowStart;
+static uint32_t windowFrames;
+static int holdingWindows, probeWindows = PROBE_WINDOWS_MIN;
+static uint32_t* sharpenRows;
+static size_t sharpenRowsSize;
+
+static float clampScale(float scale) {
+    if (!(scale > 0)) return 1.0f;
+    return scale > 1.0f ? 1.0f : scale;
+}
+
+void render_scale_configure(float scale, int targetFps, float minScale, float sharpness) {
+    scale = clampScale(scale);
+    minScale = clampScale(minScale);
+    if (minScale > scale) minScale = scale;
+    envChecked = true;
+    atomic_store_explicit(&config.scale, scale, memory_order_relaxed);
+    atomic_store_explicit(&config.targetFps, targetFps > 0 ? targetFps : 0, memory_order_relaxed);
+    atomic_store_explicit(&config.minScale, minScale, memory_order_relaxed);
+    atomic_store_explicit(&config.sharpness, sharpness < 0 ? 0 : sharpness > 1 ? 1 : sharpness, memory_order_relaxed);
+    atomic_store_explicit(&currentScale, scale, memory_order_relaxed);
+    LOG_TO_I("<%s> %s: %.2f, target fps: %d", "RenderScale", "Render scale", scale, targetFps);
+}
+
+static void configureFromEnv() {
+    if (envChecked) return;
+    envChecked = true;
+
+    const char* scale = getenv("POJAV_RENDER_SCALE");
+    const char* targetFps = getenv("POJAV_RENDER_SCALE_TARGET_FPS");
+    if (scale == NULL && targetFps == NULL) return;
+    const char* minScale = getenv("POJAV_RENDER_SCALE_MIN");
+    const char* sharpness = getenv("POJAV_RENDER_SHARPNESS");
+    render_scale_configure(scale != NULL ? strtof(scale, NULL) : 1.0f,
+                           targetFps != NULL ? atoi(targetFps) : 0,
+                           minScale != NULL ? strtof(minScale, NULL) : 0.5f,
+                           sharpness != NULL ? strtof(sharpness, NULL) : 0.0f);
+}
+
+float render_scale_current() {
+    return atomic_load_explicit(&currentScale, memory_order_relaxed);
+}
+
+static void scaleSize(float scale, int width, int height, int* scaledWidth, int* scaledHeight) {
+    *scaledWidth = width;
+    *scaledHeight = height;
+    if (scale >= 1.0f) return;
+    *scaledWidth = (int) lroundf((float) width * scale);
+    *scaledHeight = (int) lroundf((float) height * scale);
+    if (*scaledWidth < 1) *scaledWidth = 1;
+    if (*scaledHeight < 1) *scaledHeight = 1;
+}
+
+void render_scale_apply(int width, int height, int* scaledWidth, int* scaledHeight) {
+    scaleSize(render_scale_current(), width, height, scaledWidth, scaledHeight);
+}
+
+void render_scale_set_geometry(ANativeWindow* window, int32_t format) {
+    configureFromEnv();
+    float scale = render_scale_current();
+    int width, height;
+    scaleSize(scale, pojav_environ->savedWidth, pojav_environ->savedHeight, &width, &height);
+    if (scale >= 1.0f) {
+        // Full size, keep following the size of the window
+        ANativeWindow_setBuffersGeometry(window, 0, 0, format);
+    } else {
+        ANativeWindow_setBuffersGeometry(window, width, height, format);
+    }
+    // Window resizes reach the game through the input queue, only a new scale has to be told here
+    if (scale != appliedScale) atomic_store_explicit(&resizePending, true, memory_order_release);
+    appliedScale = scale;
+    appliedWindow = window;
+    appliedWidth = width;
+    appliedHeight = height;
+}
+
+static void control(int64_t now) {
+    windowFrames++;
+    if (windowStart == 0) windowStart = now;
+    if (now - windowStart < CONTROL_WINDOW_NS) return;
+    int target = atomic_load_explicit(&config.targetFps, memory_order_relaxed);
+    int64_t fpsTimes100 = (int64_t) windowFrames * 100 * 1000000000LL / (now - windowStart);
+    windowStart = now;
+    windowFrames = 0;
+    if (target == 0) return;
+
+    float scale = render_scale_current();
+    float adapted = scale;
+    if (fpsTimes100 < (int64_t) target * FALL_BELOW) {
+        float minScale = atomic_load_explicit(&config.minScale, memory_order_relaxed);
+        adapted = scale - SCALE_STEP < minScale ? minScale : scale - SCALE_STEP;
+        holdingWindows = 0;
+        if (probeWindows < PROBE_WINDOWS_MAX) probeWindows *= 2;
+    } else if (fpsTimes100 >= (int64_t) target * HOLD_ABOVE) {
+        float maxScale = atomic_load_explicit(&config.scale, memory_order_relaxed);
+        if (scale < maxScale && ++holdingWindows >= probeWindows) {
+            adapted = scale + SCALE_STEP > maxScale ? maxScale : scale + SCALE_STEP;
+            holdingWindows = 0;
+        }
+    } else {
+        holdingWindows = 0;
+    }
+    // Holding the target for long at the top scale earns quicker probes again
+    if (adapted == scale && scale >= atomic_load_explicit(&config.scale, memory_order_relaxed))
+        probeWindows = PROBE_WINDOWS_MIN;
+    if (adapted != scale) atomic_store_explicit(&currentScale, adapted, memory_order_relaxed);
+}
+
+void render_scale_on_swap(ANativeWindow* window) {
+    configureFromEnv();
+    control(telemetry_now_ns());
+    if (window == NULL) return;
+
+    int width, height;
+    float scale = render_scale_current();
+    scaleSize(scale, pojav_environ->savedWidth, pojav_environ->savedHeight, &width, &height);
+    if (window == appliedWindow && scale == appliedScale && width == appliedWidth && height == appliedHeight) return;
+    // Zero keeps the format of the window
+    render_scale_set_geometry(window, 0);
+}
+
+bool render_scale_take_resize(int* width, int* height) {
+    if (!atomic_exchange_explicit(&resizePending, false, memory_order_acquire)) return false;
+    scaleSize(appliedScale, pojav_environ->savedWidth, pojav_environ->savedHeight, width, height);
+    return true;
+}
+
+static inline uint32_t sharpenPixel(uint32_t center, uint32_t up, uint32_t down, uint32_t left, uint32_t right, int strength) {
+    uint32_t result = 0;
+    for (int shift = 0; shift < 24; shift += 8) {
+        int c = (int) (center >> shift & 0xFF);
+        int edges = 4 * c - (int) (up >> shift & 0xFF) - (int) (down >> shift & 0xFF)
+                - (int) (left >> shift & 0xFF) - (int) (right >> shift & 0xFF);
+        // strength is in 1/256ths, the edges are the sum of 4 differences
+        int value = c + (edges * strength >> 10);
+        if (value < 0) value = 0;
+        if (value > 255) value = 255;
+        result |= (uint32_t) value << shift;
+    }
+    return result | (center & 0xFF000000);
+}
+
+void render_scale_sharpen(ANativeWindow_Buffer* buffer) {
+    int strength = (int) (atomic_load_explicit(&config.sharpness, memory_order_relaxed) * 256);
+    if (strength == 0 || render_scale_current() >= 1.0f) return;
+    int width = buffer->width, height = buffer->height;
+    if (width < 3 || height < 3) return;
+
+    // The original of the row above and of the current row, the row below is still untouched
+    size_t rowsSize = (size_t) width * 2 * sizeof(uint32_t);
+    if (rowsSize > sharpenRowsSize) {
+        uint32_t* rows = realloc(sharpenRows, rowsSize);
+        if (rows == NULL) return;
+        sharpenRows = rows;
+        sharpenRowsSize = rowsSize;
+    }
+    uint32_t* above = sharpenRows;
+    uint32_t* current = sharpenRows + width;
+    uint32_t* pixels = buffer->bits;
+    memcpy(above, pixels, (size_t) width * sizeof(uint32_t));
+    for (int y = 1; y < height - 1; y++) {
+        uint32_t* row = pixels + (size_t) y * buffer->stride;
+        const uint32_t* below = row + buffer->stride;
+        memcpy(current, row, (size_t) width * sizeof(uint32_t));
+        for (int x = 1; x < width - 1; x++) {
+            row[x] = sharpenPixel(current[x], above[x], below[x], current[x - 1], current[x + 1], strength);
+        }
+        uint32_t* swap = above;
+        above = current;
+        current = swap;
+    }
+}
+
+JNIEXPORT void JNICALL
+Java_com_lanrhyme_shardlauncher_bridge_ZLBridge_setRenderScale(__attribute__((unused)) JNIEnv *env, __attribute__((unused)) jclass clazz, jfloat scale, jint targetFps, jfloat minScale, jfloat sharpness) {
+    render_scale_configure(scale, targetFps, minScale, sharpness);
+}
+
+JNIEXPORT jfloat JNICALL
+Java_com_lanrhyme_shardlauncher_bridge_ZLBridge_getRenderScale(__attribute__((unused)) JNIEnv *env, __attribute__((unused)) jclass clazz) {
+    return render_scale_current();
+}
@@ -0,0 +1,47 @@
+//
+// Render scale: the game renders into window buffers smaller than the surface and the
+// compositor stretches them over it (bilinear), which costs nothing on our side.
+// The game is told through the GLFW framebuffer size, its window size (and so the cursor
+// coordinates) stays the one of the surface.
+// Optionally, a controller adjusts the scale from the recent frame rate to hold a target.
+//
+
+#ifndef POJAVLAUNCHER_RENDER_SCALE_H
+#define POJAVLAUNCHER_RENDER_SCALE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <android/native_window.h>
+
+/**
+ * Configure the render scale, also read from POJAV_RENDER_SCALE, POJAV_RENDER_SCALE_TARGET_FPS,
+ * POJAV_RENDER_SCALE_MIN and POJAV_RENDER_SHARPNESS at startup.
+ * @param scale the scale of each dimension, up to 1. The highest one the controller goes to
+ * @param targetFps the frame rate the controller holds by lowering the scale, 0 for a fixed scale
+ * @param minScale the lowest scale the controller goes to
+ * @param sharpness strength of the sharpening pass (0-1), only for the OSMesa based renderers
+ */
+void render_scale_configure(float scale, int targetFps, float minScale, float sharpness);
+
+/** @return the scale in use right now */
+float render_scale_current();
+
+/** Scale a window size to the size of the buffers the game renders to */
+void render_scale_apply(int width, int height, int* scaledWidth, int* scaledHeight);
+
+/** Set the buffer geometry of a new window surface, in place of ANativeWindow_setBuffersGeometry(window, 0, 0, format) */
+void render_scale_set_geometry(ANativeWindow* window, int32_t format);
+
+/** Called by pojavSwapBuffers() before presenting: runs the controller and resizes the buffers when needed */
+void render_scale_on_swap(ANativeWindow* window);
+
+/**
+ * Called while pumping the events of the showing window.
+ * @return true (once) if the game has to be told about a new framebuffer size
+ */
+bool render_scale_take_resize(int* width, int* height);
+
+/** Sharpen a presented frame in place, OSMesa renderers only (RGBX 8888 buffers) */
+void render_scale_sharpen(ANativeWindow_Buffer* buffer);
+
+#endif //POJAVLAUNCHER_RENDER_SCALE_H
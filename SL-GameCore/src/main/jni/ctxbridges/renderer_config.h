@@ -8,6 +8,7 @@
 #define RENDERER_VK_ZINK 2
 #define RENDERER_VIRGL 3
 #define RENDERER_VULKAN 4
+#define RENDERER_HEADLESS 5
 
 
 #ifndef POTATOBRIDGE_H
@@ -0,0 +1,312 @@
+//
+// Shader cache manager, see shader_cache.h
+//
+// Mesa does the caching itself, here it's only pointed at the right directory and given a size limit,
+// which Mesa enforces in that directory. The budget of the whole root is enforced on a background
+// thread at startup, so it never delays the first frame, by evicting from the directories of the
+// other renderers: the current one is Mesa's, it may be reading it already. Only the directories named
+// <renderer>-<version hash> are ours, anything else under the root is left alone.
+//
+// Access times can't tell what was used: /data is mounted noatime. Instead every session touches
+// the directory of its renderer, and eviction goes by the last session of each directory, then by
+// the age of the files. Mesa doesn't report its hits either: files written this session are misses,
+// but nothing on disk shows which ones were read, so hits are reported as unknown.
+//
+
+#include <jni.h>
+#include <dirent.h>
+#include <errno.h>
+#include <ftw.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/system_properties.h>
+
+#include "logger/logger.h"
+#include "osmesa_loader.h"
+#include "shader_cache.h"
+
+#define DEFAULT_BUDGET_MB 512
+#define SCAN_FD_LIMIT 16
+#define VERSION_DIGITS 16 // Of the version hash ending the directory names, as written by shader_cache_setup()
+
+typedef struct {
+    char* path;
+    off_t size;
+    time_t dirLastUse; // Last session of the renderer directory the file is in
+    time_t written;
+} cache_file_t;
+
+static struct {
+    pthread_mutex_t lock;
+    char* root;
+    char* dir; // Of the current renderer, NULL if the cache isn't managed
+    const char* prefix; // Of the directory names of the current renderer, version hash excluded
+    time_t sessionStart;
+    uint64_t budget;
+    uint64_t startEntries, startBytes;
+    uint64_t evictedEntries, evictedBytes;
+    bool invalidated; // A directory of another version was deleted
+} cache = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+/* nftw() has no user data, the callbacks work on these under the lock */
+static struct {
+    uint64_t entries, bytes, written;
+    uint64_t startEntries, startBytes;
+} scan;
+static cache_file_t* files;
+static size_t fileCount, fileCapacity;
+static uint64_t currentDirBytes;
+static time_t dirLastUse;
+static bool inRendererDir;
+
+static uint64_t hash_bytes(uint64_t hash, const void* data, size_t size) {
+    for (size_t i = 0; i < size; i++) hash = (hash ^ ((const uint8_t*) data)[i]) * 1099511628211ull;
+    return hash;
+}
+
+static uint64_t hash_string(uint64_t hash, const char* string) {
+    return string == NULL ? hash_bytes(hash, "", 1) : hash_bytes(hash, string, strlen(string) + 1);
+}
+
+/* A file stands for its size and modification time, they change when it's replaced */
+static uint64_t hash_file(uint64_t hash, const char* path) {
+    struct stat info;
+    if (path == NULL || stat(path, &info) != 0) return hash_string(hash, NULL);
+    int64_t values[] = { (int64_t) info.st_size, (int64_t) info.st_mtime };
+    return hash_bytes(hash_string(hash, path), values, sizeof(values));
+}
+
+static uint64_t hash_property(uint64_t hash, const char* name) {
+    char value[PROP_VALUE_MAX] = "";
+    __system_property_get(name, value);
+    return hash_string(hash, value);
+}
+
+/** Everything the compiled shaders of this renderer depend on */
+static uint64_t cache_version(const char* renderer) {
+    uint64_t hash = 14695981039346656037ull;
+    hash = hash_string(hash, renderer);
+    hash = hash_string(hash, getenv("GALLIUM_DRIVER"));
+    hash = hash_string(hash, getenv("MESA_LOADER_DRIVER_OVERRIDE"));
+    hash = hash_string(hash, getenv("POJAV_ZINK_PREFER_SYSTEM_DRIVER"));
+    char* library = construct_main_path(getenv("LIB_MESA_NAME"), getenv("POJAV_NATIVEDIR"));
+    hash = hash_file(hash, library);
+    free(library);
+    // Recreated by every launcher update, which may bring a new Turnip too
+    hash = hash_file(hash, getenv("POJAV_NATIVEDIR"));
+    // The system Vulkan and GL drivers come with the system or vendor build
+    hash = hash_property(hash, "ro.build.fingerprint");
+    hash = hash_property(hash, "ro.vendor.build.fingerprint");
+    return hash;
+}
+
+static bool make_dirs(char* path) {
+    for (char* slash = strchr(path + 1, '/'); slash != NULL; slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        bool failed = mkdir(path, 0700) != 0 && errno != EEXIST;
+        *slash = '/';
+        if (failed) return false;
+    }
+    return mkdir(path, 0700) == 0 || errno == EEXIST;
+}
+
+/** Whether a directory right under the root is a renderer directory, <renderer>-<version hash> */
+static bool is_renderer_dir(const char* name) {
+    size_t length = strlen(name);
+    if (length < VERSION_DIGITS + 2 || name[length - VERSION_DIGITS - 1] != '-') return false;
+    return strspn(name + length - VERSION_DIGITS, "0123456789abcdef") == VERSION_DIGITS;
+}
+
+static int scan_file(const char* path, const struct stat* info, int type, __attribute__((unused)) struct FTW* ftw) {
+    if (type != FTW_F) return 0;
+    scan.entries++;
+    scan.bytes += info->st_size;
+    if (info->st_mtime >= cache.sessionStart) {
+        scan.written++;
+    } else {
+        scan.startEntries++;
+        scan.startBytes += info->st_size;
+    }
+    return 0;
+}
+
+static void scan_dir(const char* dir) {
+    memset(&scan, 0, sizeof(scan));
+    nftw(dir, scan_file, SCAN_FD_LIMIT, FTW_PHYS);
+}
+
+static int collect_file(const char* path, const struct stat* info, int type, struct FTW* ftw) {
+    // Directories come before their contents, the files that follow belong to the last one at level 1
+    if (type == FTW_D && ftw->level == 1) {
+        inRendererDir = is_renderer_dir(path + ftw->base);
+        dirLastUse = info->st_mtime;
+    }
+    if (type != FTW_F || ftw->level < 2 || !inRendererDir) return 0;
+    size_t dirLength = strlen(cache.dir);
+    if (!strncmp(path, cache.dir, dirLength) && path[dirLength] == '/') {
+        currentDirBytes += info->st_size;
+        return 0;
+    }
+    if (fileCount == fileCapacity) {
+        size_t capacity = fileCapacity != 0 ? fileCapacity * 2 : 256;
+        cache_file_t* grown = realloc(files, capacity * sizeof(cache_file_t));
+        if (grown == NULL) return 1;
+        files = grown;
+        fileCapacity = capacity;
+    }
+    char* copy = strdup(path);
+    if (copy == NULL) return 1;
+    files[fileCount++] = (cache_file_t) {
+            copy, info->st_size, dirLastUse, info->st_mtime
+    };
+    return 0;
+}
+
+static int compare_last_use(const void* a, const void* b) {
+    const cache_file_t* first = a;
+    const cache_file_t* second = b;
+    if (first->dirLastUse != second->dirLastUse) return first->dirLastUse < second->dirLastUse ? -1 : 1;
+    return first->written < second->written ? -1 : first->written > second->written;
+}
+
+static int remove_entry(const char* path, __attribute__((unused)) const struct stat* info,
+                        __attribute__((unused)) int type, __attribute__((unused)) struct FTW* ftw) {
+    remove(path);
+    return 0;
+}
+
+/** Delete the directories of the other versions of the current renderer */
+static void delete_stale_dirs() {
+    size_t prefixLength = strlen(cache.prefix);
+    const char* current = strrchr(cache.dir, '/') + 1;
+    DIR* root = opendir(cache.root);
+    if (root == NULL) return;
+    struct dirent* entry;
+    while ((entry = readdir(root)) != NULL) {
+        if (strncmp(entry->d_name, cache.prefix, prefixLength) != 0 || entry->d_name[prefixLength] != '-'
+         || strlen(entry->d_name) != prefixLength + 1 + VERSION_DIGITS || !is_renderer_dir(entry->d_name)
+         || !strcmp(entry->d_name, current)) continue;
+        char* path;
+        if (asprintf(&path, "%s/%s", cache.root, entry->d_name) == -1) continue;
+        nftw(path, remove_entry, SCAN_FD_LIMIT, FTW_DEPTH | FTW_PHYS);
+        LOG_TO_I("<%s> %s: %s", "ShaderCache", "Deleted the cache of a previous driver version", entry->d_name);
+        cache.invalidated = true;
+        free(path);
+    }
+    closedir(root);
+}
+
+/**
+ * Evict files of the other renderers until the whole root fits the budget,
+ * from the directories unused for the longest, oldest written first
+ */
+static void enforce_budget() {
+    fileCount = 0;
+    currentDirBytes = 0;
+    inRendererDir = false;
+    nftw(cache.root, collect_file, SCAN_FD_LIMIT, FTW_PHYS);
+    uint64_t total = currentDirBytes;
+    for (size_t i = 0; i < fileCount; i++) total += files[i].size;
+    if (total > cache.budget) {
+        qsort(files, fileCount, sizeof(cache_file_t), compare_last_use);
+        for (size_t i = 0; i < fileCount && total > cache.budget; i++) {
+            if (remove(files[i].path) != 0) continue;
+            total -= files[i].size;
+            cache.evictedEntries++;
+            cache.evictedBytes += files[i].size;
+        }
+        LOG_TO_I("<%s> %s: %llu files, %llu KB", "ShaderCache", "Evicted to fit the budget",
+                 (unsigned long long) cache.evictedEntries, (unsigned long long) cache.evictedBytes / 1024);
+    }
+    for (size_t i = 0; i < fileCount; i++) free(files[i].path);
+    free(files);
+    files = NULL;
+    fileCount = fileCapacity = 0;
+}
+
+static void* shader_cache_maintain(__attribute__((unused)) void* arg) {
+    pthread_mutex_lock(&cache.lock);
+    delete_stale_dirs();
+    scan_dir(cache.dir);
+    cache.startEntries = scan.startEntries;
+    cache.startBytes = scan.startBytes;
+    enforce_budget();
+    LOG_TO_I("<%s> %s: %llu files, %llu KB", "ShaderCache", "Cache at startup",
+             (unsigned long long) cache.startEntries, (unsigned long long) cache.startBytes / 1024);
+    pthread_mutex_unlock(&cache.lock);
+    return NULL;
+}
+
+void shader_cache_setup(const char* renderer) {
+    const char* enabled = getenv("POJAV_SHADER_CACHE");
+    if (enabled != NULL && !strcmp(enabled, "0")) return;
+    if (!strncmp("opengles", renderer, 8)) {
+        // GL4ES runs on the system GLES driver, whose binaries Android's EGL blob cache already keeps
+        return;
+    }
+    if (getenv("MESA_SHADER_CACHE_DIR") != NULL) {
+        LOG_TO_I("<%s> %s", "ShaderCache", "MESA_SHADER_CACHE_DIR is set, leaving the cache alone");
+        return;
+    }
+
+    const char* root = getenv("POJAV_SHADER_CACHE_DIR");
+    const char* budget = getenv("POJAV_SHADER_CACHE_MAX_MB");
+    char* dir;
+    if (root != NULL) cache.root = strdup(root);
+    else if (getenv("TMPDIR") == NULL || asprintf(&cache.root, "%s/shader_cache", getenv("TMPDIR")) == -1) cache.root = NULL;
+    if (cache.root == NULL) return;
+    cache.budget = (uint64_t) (budget != NULL && atoi(budget) > 0 ? atoi(budget) : DEFAULT_BUDGET_MB) << 20;
+    cache.prefix = renderer;
+    if (asprintf(&dir, "%s/%s-%016llx", cache.root, renderer, (unsigned long long) cache_version(renderer)) == -1) return;
+    if (!make_dirs(dir)) {
+        LOG_TO_E("<%s> %s: %s", "ShaderCache", "Failed to create the cache directory", dir);
+        free(dir);
+        return;
+    }
+    cache.dir = dir;
+    cache.sessionStart = time(NULL);
+    // Marks the directory as used by this session, whether Mesa writes to it or only reads
+    utimensat(AT_FDCWD, cache.dir, NULL, 0);
+
+    char maxSize[24];
+    snprintf(maxSize, sizeof(maxSize), "%lluM", (unsigned long long) (cache.budget >> 20));
+    setenv("MESA_SHADER_CACHE_DIR", cache.dir, 1);
+    setenv("MESA_GLSL_CACHE_DIR", cache.dir, 1); // Before Mesa 20.3
+    setenv("MESA_SHADER_CACHE_MAX_SIZE", maxSize, 0);
+    setenv("MESA_SHADER_CACHE_DISABLE", "false", 0);
+    LOG_TO_I("<%s> %s: %s", "ShaderCache", "Using the cache directory", cache.dir);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, shader_cache_maintain, NULL) != 0) return;
+    pthread_setname_np(thread, "ShaderCache");
+    pthread_detach(thread);
+}
+
+/**
+ * @return { files at startup, bytes at startup, files now, bytes now, written this session (misses),
+ *           -1 for the hits, which can't be known, evicted files, evicted bytes, 1 if a previous driver version was dropped },
+ *           or null if the cache isn't managed
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_lanrhyme_shardlauncher_bridge_ZLBridge_getShaderCacheStats(JNIEnv *env, __attribute__((unused)) jclass clazz) {
+    if (cache.dir == NULL) return NULL;
+    pthread_mutex_lock(&cache.lock);
+    scan_dir(cache.dir);
+    jlong values[] = {
+            (jlong) cache.startEntries, (jlong) cache.startBytes, (jlong) scan.entries, (jlong) scan.bytes,
+            (jlong) scan.written, -1, (jlong) cache.evictedEntries, (jlong) cache.evictedBytes,
+            cache.invalidated
+    };
+    pthread_mutex_unlock(&cache.lock);
+    jlongArray result = (*env)->NewLongArray(env, sizeof(values) / sizeof(values[0]));
+    if (result == NULL) return NULL;
+    (*env)->SetLongArrayRegion(env, result, 0, sizeof(values) / sizeof(values[0]), values);
+    return result;
+}
@@ -0,0 +1,18 @@
+//
+// Shader cache manager: gives the Mesa based renderers a persistent disk cache of their own.
+// Each renderer gets a directory under the cache root (POJAV_SHADER_CACHE_DIR, $TMPDIR/shader_cache
+// by default) named after a hash of what its shaders depend on: the renderer, its library,
+// the native libraries of the launcher and the system build. A new driver or launcher version
+// gets an empty directory, and the directories of the versions it replaced are deleted.
+// The whole root is kept under POJAV_SHADER_CACHE_MAX_MB by evicting the files of the renderers
+// unused for the longest, oldest written first.
+// POJAV_SHADER_CACHE=0 leaves the cache configuration to Mesa.
+//
+
+#ifndef POJAVLAUNCHER_SHADER_CACHE_H
+#define POJAVLAUNCHER_SHADER_CACHE_H
+
+/* Called once the renderer is known, before its library is loaded */
+void shader_cache_setup(const char* renderer);
+
+#endif //POJAVLAUNCHER_SHADER_CACHE_H
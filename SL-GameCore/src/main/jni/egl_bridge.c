@@ -15,6 +15,9 @@
 #include "ctxbridges/osmesa_loader.h"
 #include "ctxbridges/renderer_config.h"
 #include "ctxbridges/virgl_bridge.h"
+#include "ctxbridges/render_scale.h"
+#include "ctxbridges/gl_profiler.h"
+#include "ctxbridges/shader_cache.h"
 #include "driver_helper/nsbypass.h"
 
 #ifdef GLES_TEST
@@ -31,6 +34,9 @@
 #include "utils.h"
 #include "ctxbridges/bridge_tbl.h"
 #include "ctxbridges/osm_bridge.h"
+#include "telemetry/input_latency.h"
+#include "telemetry/frame_time.h"
+#include "frame_limiter.h"
 
 #define GLFW_CLIENT_API 0x22001
 /* Consider GLFW_NO_API as Vulkan API */
@@ -46,7 +52,6 @@ EGLConfig config;
 struct PotatoBridge potatoBridge;
 
 void* loadTurnipVulkan();
-void calculateFPS();
 
 EXTERNAL_API void pojavTerminate() {
     printf("EGLBridge: Terminating\n");
@@ -155,6 +160,12 @@ int pojavInitOpenGL() {
         set_osm_bridge_tbl();
     }
 
+    if (!strcmp(renderer, "headless_osmesa"))
+    {
+        pojav_environ->config_renderer = RENDERER_HEADLESS;
+        set_headless_bridge_tbl();
+    }
+
     if (!strcmp(renderer, "gallium_virgl"))
     {
         pojav_environ->config_renderer = RENDERER_VIRGL;
@@ -164,11 +175,13 @@ int pojavInitOpenGL() {
         setenv("MESA_GLSL_VERSION_OVERRIDE", "430", 1);
         if (!strcmp(getenv("OSMESA_NO_FLUSH_FRONTBUFFER"), "1"))
             printf("VirGL: OSMesa buffer flush is DISABLED!\n");
+        shader_cache_setup(renderer);
         loadSymbolsVirGL();
         virglInit();
         return 0;
     }
 
+    shader_cache_setup(renderer);
     if (br_init()) br_setup_window();
 
     return 0;
@@ -202,11 +215,14 @@ EXTERNAL_API void pojavSetWindowHint(int hint, int value) {
 }
 
 EXTERNAL_API void pojavSwapBuffers() {
-    calculateFPS();
+    frame_limiter_wait();
 
     if (pojav_environ->config_renderer == RENDERER_VK_ZINK
-     || pojav_environ->config_renderer == RENDERER_GL4ES)
+     || pojav_environ->config_renderer == RENDERER_GL4ES
+     || pojav_environ->config_renderer == RENDERER_HEADLESS)
     {
+        if (pojav_environ->mainWindowBundle != NULL && br_get_current() == pojav_environ->mainWindowBundle)
+            render_scale_on_swap(pojav_environ->mainWindowBundle->nativeSurface);
         br_swap_buffers();
     }
 
@@ -215,11 +231,15 @@ EXTERNAL_API void pojavSwapBuffers() {
         virglSwapBuffers();
     }
 
+    frame_time_on_present();
+    input_latency_on_present();
+    gl_profiler_on_frame();
 }
 
 EXTERNAL_API void pojavMakeCurrent(void* window) {
     if (pojav_environ->config_renderer == RENDERER_VK_ZINK
-     || pojav_environ->config_renderer == RENDERER_GL4ES)
+     || pojav_environ->config_renderer == RENDERER_GL4ES
+     || pojav_environ->config_renderer == RENDERER_HEADLESS)
     {
         br_make_current((basic_render_window_t*)window);
     }
@@ -231,6 +251,21 @@ EXTERNAL_API void pojavMakeCurrent(void* window) {
 
 }
 
+/**
+ * Take a background context sharing objects with the game's, current on the calling thread
+ * with a 1x1 pbuffer, for uploads off the render thread. Pool size: POJAV_WORKER_CONTEXTS, none by default.
+ * @return the worker to give back with pojavReleaseWorkerContext(), or NULL if none is available
+ */
+EXTERNAL_API void* pojavAcquireWorkerContext() {
+    if (br_acquire_worker_context == NULL) return NULL;
+    return br_acquire_worker_context();
+}
+
+/** Finish the work of a worker context and give it back, from the thread that acquired it */
+EXTERNAL_API void pojavReleaseWorkerContext(void* worker) {
+    if (br_release_worker_context != NULL) br_release_worker_context(worker);
+}
+
 EXTERNAL_API void* pojavCreateContext(void* contextSrc) {
     if (pojav_environ->config_renderer == RENDERER_VULKAN)
         return (void *) pojav_environ->pojavWindow;
@@ -249,29 +284,6 @@ void* maybe_load_vulkan() {
     return (void*) strtoul(getenv("VULKAN_PTR"), NULL, 0x10);
 }
 
-static int frameCount = 0;
-static time_t lastTime = 0;
-
-void calculateFPS() {
-    frameCount++;
-    time_t currentTime = time(NULL);
-
-    if (currentTime != lastTime) {
-        lastTime = currentTime;
-
-        if (!pojav_environ->dalvikJavaVMPtr ||!pojav_environ->class_ZLInvoker ||!pojav_environ->method_PutFpsValue) {
-            return;
-        }
-
-        JNIEnv *dalvikEnv;
-        (*pojav_environ->dalvikJavaVMPtr)->AttachCurrentThread(pojav_environ->dalvikJavaVMPtr,&dalvikEnv,NULL);
-        (*dalvikEnv)->CallStaticVoidMethod(dalvikEnv,pojav_environ->class_ZLInvoker,pojav_environ->method_PutFpsValue,(jint) frameCount);
-        (*pojav_environ->dalvikJavaVMPtr)->DetachCurrentThread(pojav_environ->dalvikJavaVMPtr);
-
-        frameCount = 0;
-    }
-}
-
 EXTERNAL_API JNIEXPORT jlong JNICALL
 Java_org_lwjgl_vulkan_VK_getVulkanDriverHandle(ABI_COMPAT JNIEnv *env, ABI_COMPAT jclass thiz) {
     printf("EGLBridge: LWJGL-side Vulkan loader requested the Vulkan handle\n");
@@ -280,7 +292,8 @@ Java_org_lwjgl_vulkan_VK_getVulkanDriverHandle(ABI_COMPAT JNIEnv *env, ABI_COMPA
 
 EXTERNAL_API void pojavSwapInterval(int interval) {
     if (pojav_environ->config_renderer == RENDERER_VK_ZINK
-     || pojav_environ->config_renderer == RENDERER_GL4ES)
+     || pojav_environ->config_renderer == RENDERER_GL4ES
+     || pojav_environ->config_renderer == RENDERER_HEADLESS)
     {
         br_swap_interval(interval);
     }
@@ -12,7 +12,8 @@ __attribute__((constructor)) void env_init() {
     char* strptr_env = getenv("POJAV_ENVIRON");
     if(strptr_env == NULL) {
         __android_log_print(ANDROID_LOG_INFO, "Environ", "No environ found, creating...");
-        pojav_environ = malloc(sizeof(struct pojav_environ_s));
+        // The input ring keeps its producer and consumer on separate cache lines
+        if(posix_memalign((void**) &pojav_environ, CACHE_LINE_SIZE, sizeof(struct pojav_environ_s)) != 0) abort();
         assert(pojav_environ);
         memset(pojav_environ, 0 , sizeof(struct pojav_environ_s));
         if(asprintf(&strptr_env, "%p", pojav_environ) == -1) abort();
@@ -9,17 +9,88 @@
 #include <stdatomic.h>
 #include <jni.h>
 
-/* How many events can be handled at the same time */
-#define EVENT_WINDOW_SIZE 8000
+/* How many events can be handled at the same time. Must be a power of two */
+#define EVENT_WINDOW_SIZE 8192
+/* Slots that motion events may never occupy, so key and button edges always have room */
+#define EVENT_EDGE_RESERVE (EVENT_WINDOW_SIZE / 4)
+#define CACHE_LINE_SIZE 64
+
+/* What sendData() does once the queue is (almost) full */
+#define INPUT_OVERFLOW_DROP_MOTION 0 // Motion is refused early, edges use the reserved slots
+#define INPUT_OVERFLOW_DROP_NEWEST 1 // Whatever arrives while the queue is full is refused
+
+/* How cursor motion coming from Android reaches the game */
+#define CURSOR_MOTION_DIRECT 0 // Invoke the callback on every sample, or keep the latest one in stack queue mode
+#define CURSOR_MOTION_COALESCE 1 // Keep the latest position, the game gets it once per pump
+#define CURSOR_MOTION_HISTORY 2 // Queue every sample, the game gets up to cursorHistoryDepth of them per pump, in order
 
 typedef struct {
     int type;
-    int i1;
-    int i2;
-    int i3;
-    int i4;
+    union {
+        struct {
+            int i1;
+            int i2;
+            int i3;
+            int i4;
+        };
+        struct {
+            float x; // EVENT_TYPE_CURSOR_POS
+            float y;
+        };
+    };
+    int64_t time; // CLOCK_MONOTONIC nanoseconds at which sendData() queued the event
 } GLFWInputEvent;
 
+/*
+ * Single producer (Android UI thread) / single consumer (game thread) event queue.
+ * head and tail are free-running counters, the slot is picked by masking them.
+ * Each side lives on its own cache line so the two threads don't fight over it.
+ */
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t head; // Next event to be filled, only written by the producer
+    size_t cachedTail; // Producer-side copy of tail, refreshed only when the queue looks full
+    atomic_uint producers; // Producers inside sendData(), a slot is only reset for a new window once they left
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t tail; // Next event to be pumped out, only written by the consumer
+    size_t pumpTarget; // Where the current pump round stops, snapshot of head taken by pojavStartPumping()
+    size_t pumpCursorSkip; // Cursor samples of the current round that exceed the history depth
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t droppedMotion;
+    atomic_size_t droppedEdges;
+    _Alignas(CACHE_LINE_SIZE) GLFWInputEvent events[EVENT_WINDOW_SIZE];
+} GLFWInputRing;
+
+/*
+ * Cursor motion published by Android. Only the game thread moves pojav_environ->cursorX/Y, from this.
+ * Relative motion emulates GLFW_RAW_MOUSE_MOTION while the cursor is grabbed.
+ * The producer only ever grows the totals and the game thread delivers the difference to what it
+ * already consumed. Reading the pair torn only postpones part of a delta to the next pump, nothing is lost.
+ * Absolute positions are two floats packed in one word, so they can't tear at all.
+ */
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) _Atomic double totalX; // Only written by the producer
+    _Atomic double totalY;
+    _Atomic uint64_t position; // Newest absolute position, only written by the producer
+    atomic_uint positionSerial; // Bumped by the producer once position holds a new one
+    _Alignas(CACHE_LINE_SIZE) double consumedX; // Only accessed by the game thread
+    double consumedY;
+    unsigned consumedPositionSerial;
+    bool pending; // The current pump round delivers raw motion
+} GLFWRawMotion;
+
+#define GAMEPAD_BUTTON_COUNT 15 // GLFW_GAMEPAD_BUTTON_LAST + 1
+#define GAMEPAD_AXIS_COUNT 6 // GLFW_GAMEPAD_AXIS_LAST + 1
+
+/*
+ * Emulated gamepad, written by Android and read by the game through direct buffers over the same memory.
+ * state has the layout of GLFWgamepadstate, so it can be copied or pointed at as is.
+ */
+typedef struct {
+    struct {
+        unsigned char buttons[GAMEPAD_BUTTON_COUNT];
+        float axes[GAMEPAD_AXIS_COUNT];
+    } state;
+    int32_t connected;
+} GLFWGamepadShared;
+
 typedef void GLFW_invoke_Char_func(void* window, unsigned int codepoint);
 typedef void GLFW_invoke_CharMods_func(void* window, unsigned int codepoint, int mods);
 typedef void GLFW_invoke_CursorEnter_func(void* window, int entered);
@@ -30,17 +101,39 @@ typedef void GLFW_invoke_MouseButton_func(void* window, int button, int action,
 typedef void GLFW_invoke_Scroll_func(void* window, double xoffset, double yoffset);
 typedef void GLFW_invoke_WindowSize_func(void* window, int width, int height);
 
+/* How many GLFW windows can have their own callbacks and event queue */
+#define MAX_INPUT_WINDOWS 8
+
+/* Callback table and event queue of a single GLFW window, keyed by its handle */
+typedef struct {
+    _Atomic long window; // 0 once the window dropped all its callbacks, the slot then goes to the next new window
+#define ADD_CALLBACK_WWIN(NAME) \
+    GLFW_invoke_##NAME##_func* GLFW_invoke_##NAME;
+    ADD_CALLBACK_WWIN(Char);
+    ADD_CALLBACK_WWIN(CharMods);
+    ADD_CALLBACK_WWIN(CursorEnter);
+    ADD_CALLBACK_WWIN(CursorPos);
+    ADD_CALLBACK_WWIN(FramebufferSize);
+    ADD_CALLBACK_WWIN(Key);
+    ADD_CALLBACK_WWIN(MouseButton);
+    ADD_CALLBACK_WWIN(Scroll);
+    ADD_CALLBACK_WWIN(WindowSize);
+
+#undef ADD_CALLBACK_WWIN
+    GLFWInputRing ring;
+} GLFWWindowInput;
+
 struct pojav_environ_s {
     struct ANativeWindow* pojavWindow;
     basic_render_window_t* mainWindowBundle;
     int config_renderer;
-    atomic_size_t eventCounter; // Count the number of events to be pumped out
-    GLFWInputEvent events[EVENT_WINDOW_SIZE];
-    size_t outEventIndex; // Point to the current event that has yet to be pumped out to MC
-    size_t outTargetIndex; // Point to the newt index to stop by
-    size_t inEventIndex; // Point to the next event that has to be filled
-    size_t inEventCount; // Count registered right before pumping OUT events. Used as a cache.
+    _Atomic(GLFWWindowInput*) inputWindows[MAX_INPUT_WINDOWS]; // Filled in order, never freed but reused
+    _Atomic(GLFWWindowInput*) showingInput; // Input state of showingWindow, where Android events go
+    int inputOverflowPolicy;
+    void* inputBatchBuffer; // Direct buffer registered by CallbackBridge for nativeSubmitBatch()
+    int inputBatchCapacity; // In records
     double cursorX, cursorY, cLastX, cLastY;
+    GLFWRawMotion rawMotion;
     jmethodID method_accessAndroidClipboard;
     jmethodID method_onGrabStateChanged;
     jmethodID method_onCursorShapeChanged;
@@ -53,26 +146,15 @@ struct pojav_environ_s {
     jboolean isGrabbing;
     jbyte* keyDownBuffer;
     jbyte* mouseDownBuffer;
+    GLFWGamepadShared gamepad; // Joystick 1, shared with CallbackBridge and the GLFW classes
     JavaVM* runtimeJavaVMPtr;
     JNIEnv* runtimeJNIEnvPtr_JRE;
     JavaVM* dalvikJavaVMPtr;
     JNIEnv* dalvikJNIEnvPtr_ANDROID;
     long showingWindow;
     bool isInputReady, isCursorEntered, isUseStackQueueCall, shouldUpdateMouse;
+    int cursorMotionMode, cursorHistoryDepth;
     int savedWidth, savedHeight;
-#define ADD_CALLBACK_WWIN(NAME) \
-    GLFW_invoke_##NAME##_func* GLFW_invoke_##NAME;
-    ADD_CALLBACK_WWIN(Char);
-    ADD_CALLBACK_WWIN(CharMods);
-    ADD_CALLBACK_WWIN(CursorEnter);
-    ADD_CALLBACK_WWIN(CursorPos);
-    ADD_CALLBACK_WWIN(FramebufferSize);
-    ADD_CALLBACK_WWIN(Key);
-    ADD_CALLBACK_WWIN(MouseButton);
-    ADD_CALLBACK_WWIN(Scroll);
-    ADD_CALLBACK_WWIN(WindowSize);
-
-#undef ADD_CALLBACK_WWIN
 };
 extern struct pojav_environ_s *pojav_environ;
 
@@ -0,0 +1,143 @@
+//
+// Frame limiter, see frame_limiter.h
+//
+// The deadlines are spaced by the frame period and don't depend on when the wait actually ended,
+// so oversleeping on one frame is made up on the next one. A frame that misses its deadline by
+// more than a period resets the schedule instead of rushing the following frames.
+//
+// The adaptive mode looks at the work time of each frame (from the end of a wait to the start of
+// the next one), which, unlike the frame time, isn't hidden by the limiter itself.
+//
+
+#include <jni.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "logger/logger.h"
+#include "telemetry/histogram.h"
+#include "frame_limiter.h"
+
+/* How early to stop sleeping and start spinning, covers the usual wakeup latency */
+#define SPIN_MARGIN_NS 1000000LL
+#define SECOND_NS 1000000000LL
+
+/* Adaptive pacing, evaluated once per window of frames */
+#define ADAPT_WINDOW_NS SECOND_NS
+#define ADAPT_STEP_FPS 5
+#define ADAPT_MIN_FPS 20
+#define ADAPT_PERCENTILE 90
+#define ADAPT_LOWER_LOAD 95 // Lower the target once the work takes this much (%) of the period
+#define ADAPT_RAISE_LOAD 75 // Raise it once the work fits in this much (%) of the next period up
+#define ADAPT_RAISE_WINDOWS 3 // ...for that many windows in a row, to avoid bouncing
+
+static atomic_int configuredFps;
+static atomic_bool adaptiveMode;
+static atomic_int currentFps;
+static bool envChecked;
+
+/* Render thread only */
+static int64_t nextDeadline;
+static int64_t lastWaitEnd;
+static histogram_t workTimes;
+static int64_t windowStart;
+static int goodWindows;
+
+void frame_limiter_configure(int fps, bool adaptive) {
+    if (fps < 0) fps = 0;
+    envChecked = true;
+    atomic_store_explicit(&adaptiveMode, adaptive, memory_order_relaxed);
+    atomic_store_explicit(&configuredFps, fps, memory_order_relaxed);
+    atomic_store_explicit(&currentFps, fps, memory_order_relaxed);
+    LOG_TO_I("<%s> %s: %d%s", "FrameLimiter", "Frame rate limit", fps, adaptive ? " (adaptive)" : "");
+}
+
+int frame_limiter_current_target() {
+    return atomic_load_explicit(&currentFps, memory_order_relaxed);
+}
+
+static void configureFromEnv() {
+    if (envChecked) return;
+    envChecked = true;
+
+    const char* limit = getenv("POJAV_FPS_LIMIT");
+    if (limit == NULL) return;
+    const char* adaptive = getenv("POJAV_FPS_LIMIT_ADAPTIVE");
+    frame_limiter_configure(atoi(limit), adaptive != NULL && strcmp(adaptive, "1") == 0);
+}
+
+static void adapt(int64_t now, int target, int configured) {
+    if (now - windowStart < ADAPT_WINDOW_NS) return;
+    windowStart = now;
+    if (workTimes.count == 0) return;
+
+    int64_t work = (int64_t) histogram_percentile(&workTimes, ADAPT_PERCENTILE);
+    histogram_reset(&workTimes);
+    int adapted = target;
+    if (work * 100 > SECOND_NS / target * ADAPT_LOWER_LOAD) {
+        // Fall straight to a rate the frames can hold, one step at a time would take seconds
+        adapted = (int) (SECOND_NS * ADAPT_LOWER_LOAD / 100 / work);
+        adapted -= adapted % ADAPT_STEP_FPS;
+        if (adapted >= target) adapted = target - ADAPT_STEP_FPS;
+        if (adapted < ADAPT_MIN_FPS) adapted = ADAPT_MIN_FPS;
+        goodWindows = 0;
+    } else if (target < configured) {
+        int raised = target + ADAPT_STEP_FPS > configured ? configured : target + ADAPT_STEP_FPS;
+        if (work * 100 <= SECOND_NS / raised * ADAPT_RAISE_LOAD) {
+            if (++goodWindows >= ADAPT_RAISE_WINDOWS) {
+                adapted = raised;
+                goodWindows = 0;
+            }
+        } else {
+            goodWindows = 0;
+        }
+    }
+    if (adapted != target) {
+        atomic_store_explicit(&currentFps, adapted, memory_order_relaxed);
+        LOG_TO_I("<%s> %s: %d", "FrameLimiter", "Adaptive target", adapted);
+    }
+}
+
+void frame_limiter_wait() {
+    configureFromEnv();
+    int target = atomic_load_explicit(&currentFps, memory_order_relaxed);
+    int64_t now = telemetry_now_ns();
+    if (target <= 0) {
+        nextDeadline = lastWaitEnd = 0;
+        return;
+    }
+
+    if (lastWaitEnd != 0 && atomic_load_explicit(&adaptiveMode, memory_order_relaxed)) {
+        histogram_record(&workTimes, (uint64_t) (now - lastWaitEnd));
+        adapt(now, target, atomic_load_explicit(&configuredFps, memory_order_relaxed));
+        target = atomic_load_explicit(&currentFps, memory_order_relaxed);
+    }
+
+    int64_t period = SECOND_NS / target;
+    if (nextDeadline == 0 || now - nextDeadline > period) {
+        // First frame, or too late to catch up: start over from here.
+        // The adaptive window keeps going, an overloaded game misses deadlines all the time.
+        if (nextDeadline == 0) windowStart = now;
+        nextDeadline = now;
+    } else {
+        int64_t sleepUntil = nextDeadline - SPIN_MARGIN_NS;
+        if (sleepUntil > now) {
+            struct timespec ts = { .tv_sec = sleepUntil / SECOND_NS, .tv_nsec = sleepUntil % SECOND_NS };
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        }
+        while ((now = telemetry_now_ns()) < nextDeadline);
+    }
+    nextDeadline += period;
+    lastWaitEnd = now;
+}
+
+JNIEXPORT void JNICALL
+Java_com_lanrhyme_shardlauncher_bridge_ZLBridge_setFrameLimit(__attribute__((unused)) JNIEnv *env, __attribute__((unused)) jclass clazz, jint fps, jboolean adaptive) {
+    frame_limiter_configure(fps, adaptive);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_lanrhyme_shardlauncher_bridge_ZLBridge_getFrameLimit(__attribute__((unused)) JNIEnv *env, __attribute__((unused)) jclass clazz) {
+    return frame_limiter_current_target();
+}
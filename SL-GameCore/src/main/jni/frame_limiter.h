@@ -0,0 +1,26 @@
+//
+// Frame limiter, paces pojavSwapBuffers() to a target frame rate on every backend.
+// Waits on CLOCK_MONOTONIC: sleeps most of the way, then spins for the last stretch so the
+// presents stay evenly spaced. The adaptive mode lowers the target while the device can't keep up
+// (typically once it throttles) and raises it back when it recovers, so frame times stay flat.
+//
+
+#ifndef POJAVLAUNCHER_FRAME_LIMITER_H
+#define POJAVLAUNCHER_FRAME_LIMITER_H
+
+#include <stdbool.h>
+
+/**
+ * Set the frame rate limit, also read from POJAV_FPS_LIMIT and POJAV_FPS_LIMIT_ADAPTIVE=1 at startup.
+ * @param fps the target frame rate, 0 to disable the limiter
+ * @param adaptive whether the target may be lowered below fps while the frames can't keep up
+ */
+void frame_limiter_configure(int fps, bool adaptive);
+
+/** @return the frame rate currently paced to, below the configured one while adapting, 0 if disabled */
+int frame_limiter_current_target();
+
+/** Called by pojavSwapBuffers() on the render thread, right before presenting */
+void frame_limiter_wait();
+
+#endif //POJAVLAUNCHER_FRAME_LIMITER_H
@@ -0,0 +1,244 @@
+//
+// Native touch gesture recognizer, see gesture_engine.h
+//
+// Menus: the cursor follows the first finger, a tap is a left click, a long press holds the left button.
+// In game (cursor grabbed): dragging moves the camera through the sensitivity curve, as raw motion,
+// a tap is a right click (use), a long press holds the left button (break).
+// Both: two fingers pinching scroll, a two-finger tap is a right click.
+//
+
+#include <jni.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "logger/logger.h"
+#include "utils.h"
+#include "environ/environ.h"
+#include "gesture_engine.h"
+
+/* MotionEvent.ACTION_* */
+#define ACTION_DOWN 0
+#define ACTION_UP 1
+#define ACTION_MOVE 2
+#define ACTION_CANCEL 3
+#define ACTION_POINTER_DOWN 5
+#define ACTION_POINTER_UP 6
+
+#define GLFW_MOUSE_BUTTON_LEFT 0
+#define GLFW_MOUSE_BUTTON_RIGHT 1
+#define GLFW_RELEASE 0
+#define GLFW_PRESS 1
+
+static struct {
+    int flags;
+    float sensitivity; // Camera pixels per finger pixel
+    float acceleration; // Exponent applied to the finger speed, 1 is linear
+    int longPressMs;
+    float tapSlop; // How far a finger may wander and still tap, in window pixels
+    float scrollStep; // Pinch travel per scroll step, in window pixels
+} config = { GESTURE_ALL, 1.0f, 1.0f, 300, 10.0f, 40.0f };
+
+static gesture_touch_buffer_t* touchBuffer;
+
+/* The gesture in progress, from the first finger down to the last one up */
+static struct {
+    bool active;
+    int32_t primaryId; // The finger driving the cursor or camera
+    float downX, downY, lastX, lastY;
+    jlong downTime;
+    int maxPointers;
+    bool moved, longPressed, scrolled;
+    float pinchDistance, pinchTravel;
+} touch;
+
+static float cursorX, cursorY;
+
+static const gesture_pointer_t* findPointer(int32_t id, int count) {
+    for (int i = 0; i < count; i++) {
+        if (touchBuffer->pointers[i].id == id) return &touchBuffer->pointers[i];
+    }
+    return NULL;
+}
+
+static float pointerDistance(const gesture_pointer_t* a, const gesture_pointer_t* b) {
+    return hypotf(a->x - b->x, a->y - b->y);
+}
+
+static void moveCursor(float x, float y) {
+    cursorX = x;
+    cursorY = y;
+    critical_send_cursor_pos(x, y);
+}
+
+static void click(int button, int mods) {
+    critical_send_mouse_button(button, GLFW_PRESS, mods);
+    critical_send_mouse_button(button, GLFW_RELEASE, mods);
+}
+
+static void dragCamera(float dx, float dy) {
+    float distance = hypotf(dx, dy);
+    if (distance == 0) return;
+    float gain = config.sensitivity * powf(distance, config.acceleration - 1.0f);
+    critical_send_cursor_delta(dx * gain, dy * gain);
+}
+
+static void beginGesture(const gesture_pointer_t* pointer, jlong eventTime) {
+    touch.active = true;
+    touch.primaryId = pointer->id;
+    touch.downX = touch.lastX = pointer->x;
+    touch.downY = touch.lastY = pointer->y;
+    touch.downTime = eventTime;
+    touch.maxPointers = 1;
+    touch.moved = touch.longPressed = touch.scrolled = false;
+    if (!pojav_environ->isGrabbing) moveCursor(pointer->x, pointer->y);
+}
+
+/* Measure the pinch from the current pair of fingers, without counting the change of pair as travel */
+static void resetPinch(const gesture_pointer_t* a, const gesture_pointer_t* b) {
+    touch.pinchDistance = pointerDistance(a, b);
+    touch.pinchTravel = 0;
+}
+
+static void trackPinch(int pointerCount) {
+    float distance = pointerDistance(&touchBuffer->pointers[0], &touchBuffer->pointers[1]);
+    touch.pinchTravel += distance - touch.pinchDistance;
+    touch.pinchDistance = distance;
+    if (!(config.flags & GESTURE_PINCH_SCROLL) || pointerCount != 2) return;
+    // Fingers moving apart scroll up
+    while (fabsf(touch.pinchTravel) >= config.scrollStep) {
+        float direction = touch.pinchTravel > 0 ? 1.0f : -1.0f;
+        critical_send_scroll(0, direction);
+        touch.pinchTravel -= direction * config.scrollStep;
+        touch.scrolled = true;
+    }
+}
+
+static void trackPrimary(const gesture_pointer_t* pointer) {
+    if (!touch.moved && hypotf(pointer->x - touch.downX, pointer->y - touch.downY) > config.tapSlop)
+        touch.moved = true;
+    if (pojav_environ->isGrabbing) {
+        if (config.flags & GESTURE_CAMERA_DRAG) dragCamera(pointer->x - touch.lastX, pointer->y - touch.lastY);
+    } else {
+        moveCursor(pointer->x, pointer->y);
+    }
+    touch.lastX = pointer->x;
+    touch.lastY = pointer->y;
+}
+
+static void endGesture(jlong eventTime, int mods) {
+    jlong duration = eventTime - touch.downTime;
+    bool quick = !touch.moved && !touch.scrolled && duration < config.longPressMs;
+    if (touch.longPressed) {
+        critical_send_mouse_button(GLFW_MOUSE_BUTTON_LEFT, GLFW_RELEASE, mods);
+    } else if (quick && touch.maxPointers == 2 && (config.flags & GESTURE_TWO_FINGER_CLICK)) {
+        click(GLFW_MOUSE_BUTTON_RIGHT, mods);
+    } else if (quick && touch.maxPointers == 1 && (config.flags & GESTURE_TAP)) {
+        click(pojav_environ->isGrabbing ? GLFW_MOUSE_BUTTON_RIGHT : GLFW_MOUSE_BUTTON_LEFT, mods);
+    }
+    touch.active = false;
+}
+
+/**
+ * Feed one MotionEvent, whose pointers were written to the touch buffer beforehand.
+ * The buffer cursor position is read as the starting point and updated with the result.
+ */
+void critical_send_touch_event(jint action, jint actionPointerId, jint pointerCount, jint mods, jlong eventTime) {
+    if (touchBuffer == NULL || pointerCount < 1) return;
+    if (pointerCount > GESTURE_MAX_POINTERS) pointerCount = GESTURE_MAX_POINTERS;
+    cursorX = touchBuffer->cursorX;
+    cursorY = touchBuffer->cursorY;
+
+    switch (action) {
+        case ACTION_DOWN: {
+            const gesture_pointer_t* pointer = findPointer(actionPointerId, pointerCount);
+            if (pointer != NULL) beginGesture(pointer, eventTime);
+        } break;
+        case ACTION_POINTER_DOWN:
+            if (!touch.active) break;
+            if (pointerCount > touch.maxPointers) touch.maxPointers = pointerCount;
+            // The new finger may sort before the pinching pair
+            if (pointerCount >= 2) resetPinch(&touchBuffer->pointers[0], &touchBuffer->pointers[1]);
+            break;
+        case ACTION_MOVE: {
+            if (!touch.active) break;
+            if (pointerCount >= 2) trackPinch(pointerCount);
+            const gesture_pointer_t* pointer = findPointer(touch.primaryId, pointerCount);
+            // Only one finger steers, the others are busy pinching
+            if (pointer != NULL && (pointerCount == 1 || touch.longPressed)) trackPrimary(pointer);
+        } break;
+        case ACTION_POINTER_UP: {
+            if (!touch.active) break;
+            // The event still lists the finger going up, the next ones pinch with the first two that stay
+            const gesture_pointer_t* remaining[2];
+            int remainingCount = 0;
+            for (int i = 0; i < pointerCount && remainingCount < 2; i++) {
+                if (touchBuffer->pointers[i].id != actionPointerId) remaining[remainingCount++] = &touchBuffer->pointers[i];
+            }
+            if (remainingCount == 2) resetPinch(remaining[0], remaining[1]);
+            if (actionPointerId != touch.primaryId || remainingCount == 0) break;
+            // Hand the steering over without making the cursor jump
+            touch.primaryId = remaining[0]->id;
+            touch.lastX = remaining[0]->x;
+            touch.lastY = remaining[0]->y;
+        } break;
+        case ACTION_UP:
+            if (touch.active) endGesture(eventTime, mods);
+            break;
+        case ACTION_CANCEL:
+            if (touch.active && touch.longPressed)
+                critical_send_mouse_button(GLFW_MOUSE_BUTTON_LEFT, GLFW_RELEASE, mods);
+            touch.active = false;
+            break;
+    }
+
+    touchBuffer->cursorX = cursorX;
+    touchBuffer->cursorY = cursorY;
+}
+
+void noncritical_send_touch_event(__attribute__((unused)) JNIEnv* env, __attribute__((unused)) jclass clazz, jint action, jint actionPointerId, jint pointerCount, jint mods, jlong eventTime) {
+    critical_send_touch_event(action, actionPointerId, pointerCount, mods, eventTime);
+}
+
+/**
+ * Called once the long press delay after a touch has passed, with the current uptime in milliseconds.
+ * @return true if a long press just started, so that the UI can give haptic feedback
+ */
+jboolean critical_touch_tick(jlong uptime) {
+    if (!touch.active || touch.longPressed || touch.moved || touch.maxPointers != 1) return JNI_FALSE;
+    if (!(config.flags & GESTURE_LONG_PRESS) || uptime - touch.downTime < config.longPressMs) return JNI_FALSE;
+    touch.longPressed = true;
+    critical_send_mouse_button(GLFW_MOUSE_BUTTON_LEFT, GLFW_PRESS, 0);
+    return JNI_TRUE;
+}
+
+jboolean noncritical_touch_tick(__attribute__((unused)) JNIEnv* env, __attribute__((unused)) jclass clazz, jlong uptime) {
+    return critical_touch_tick(uptime);
+}
+
+void critical_set_gesture_config(jint flags, jfloat sensitivity, jfloat acceleration, jint longPressMs, jfloat tapSlop, jfloat scrollStep) {
+    if (sensitivity <= 0 || acceleration <= 0 || longPressMs < 0 || tapSlop < 0 || scrollStep <= 0) {
+        LOG_TO_W("<%s> %s", "Gesture", "Invalid gesture config, ignoring it");
+        return;
+    }
+    config.flags = flags;
+    config.sensitivity = sensitivity;
+    config.acceleration = acceleration;
+    config.longPressMs = longPressMs;
+    config.tapSlop = tapSlop;
+    config.scrollStep = scrollStep;
+}
+
+void noncritical_set_gesture_config(__attribute__((unused)) JNIEnv* env, __attribute__((unused)) jclass clazz, jint flags, jfloat sensitivity, jfloat acceleration, jint longPressMs, jfloat tapSlop, jfloat scrollStep) {
+    critical_set_gesture_config(flags, sensitivity, acceleration, longPressMs, tapSlop, scrollStep);
+}
+
+JNIEXPORT void JNICALL
+Java_org_lwjgl_glfw_CallbackBridge_nativeRegisterTouchBuffer(JNIEnv* env, __attribute__((unused)) jclass clazz, jobject buffer) {
+    void* address = (*env)->GetDirectBufferAddress(env, buffer);
+    if (address == NULL || (*env)->GetDirectBufferCapacity(env, buffer) < (jlong) sizeof(gesture_touch_buffer_t)) {
+        LOG_TO_E("<%s> %s", "Gesture", "Touch buffer is not a usable direct buffer");
+        return;
+    }
+    touchBuffer = address;
+}
@@ -0,0 +1,47 @@
+//
+// Native touch gesture recognizer.
+// CallbackBridge hands over the raw pointers of every MotionEvent through a shared direct buffer,
+// the recognized gestures go to the game through the regular send paths of input_bridge_v3.c.
+// Everything here runs on the Android UI thread.
+//
+
+#ifndef POJAVLAUNCHER_GESTURE_ENGINE_H
+#define POJAVLAUNCHER_GESTURE_ENGINE_H
+
+#include <jni.h>
+#include <stdint.h>
+
+#define GESTURE_MAX_POINTERS 10
+
+/* Gestures that can be turned on and off with nativeSetGestureConfig() */
+#define GESTURE_TAP (1 << 0) // Left click in menus, right click (use) in game
+#define GESTURE_LONG_PRESS (1 << 1) // Hold the left button (break, drag items) until the finger goes up
+#define GESTURE_PINCH_SCROLL (1 << 2) // Two fingers moving apart or together scroll
+#define GESTURE_TWO_FINGER_CLICK (1 << 3) // Tapping with two fingers is a right click
+#define GESTURE_CAMERA_DRAG (1 << 4) // Dragging moves the camera while the cursor is grabbed
+#define GESTURE_ALL (GESTURE_TAP | GESTURE_LONG_PRESS | GESTURE_PINCH_SCROLL | GESTURE_TWO_FINGER_CLICK | GESTURE_CAMERA_DRAG)
+
+/*
+ * Layout of the buffer shared with CallbackBridge, must match its TOUCH_* constants.
+ * Java fills the pointers, native writes back where the gestures left the cursor.
+ */
+typedef struct {
+    int32_t id;
+    float x; // In window (not physical) pixels
+    float y;
+} gesture_pointer_t;
+
+typedef struct {
+    float cursorX;
+    float cursorY;
+    gesture_pointer_t pointers[GESTURE_MAX_POINTERS];
+} gesture_touch_buffer_t;
+
+void critical_send_touch_event(jint action, jint actionPointerId, jint pointerCount, jint mods, jlong eventTime);
+void noncritical_send_touch_event(JNIEnv* env, jclass clazz, jint action, jint actionPointerId, jint pointerCount, jint mods, jlong eventTime);
+jboolean critical_touch_tick(jlong uptime);
+jboolean noncritical_touch_tick(JNIEnv* env, jclass clazz, jlong uptime);
+void critical_set_gesture_config(jint flags, jfloat sensitivity, jfloat acceleration, jint longPressMs, jfloat tapSlop, jfloat scrollStep);
+void noncritical_set_gesture_config(JNIEnv* env, jclass clazz, jint flags, jfloat sensitivity, jfloat acceleration, jint longPressMs, jfloat tapSlop, jfloat scrollStep);
+
+#endif //POJAVLAUNCHER_GESTURE_ENGINE_H
@@ -18,21 +18,68 @@
 #include <string.h>
 #include <stdatomic.h>
 #include <math.h>
+#include <pthread.h>
+#include <sched.h>
 
 #include "logger/logger.h"
 #include "utils.h"
 #include "environ/environ.h"
+#include "telemetry/histogram.h"
+#include "telemetry/input_latency.h"
+#include "telemetry/input_replay.h"
+#include "gesture_engine.h"
+#include "jni_attach.h"
+#include "upcall_dispatcher.h"
+#include "ctxbridges/render_scale.h"
 
 #define EVENT_TYPE_CHAR 1000
 #define EVENT_TYPE_CHAR_MODS 1001
 #define EVENT_TYPE_CURSOR_ENTER 1002
+#define EVENT_TYPE_CURSOR_POS 1003
 #define EVENT_TYPE_FRAMEBUFFER_SIZE 1004
 #define EVENT_TYPE_KEY 1005
 #define EVENT_TYPE_MOUSE_BUTTON 1006
 #define EVENT_TYPE_SCROLL 1007
 #define EVENT_TYPE_WINDOW_SIZE 1008
+#define EVENT_TYPE_CURSOR_DELTA 1009
 
 static void registerFunctions(JNIEnv *env);
+static void dispatchInputEvent(const input_replay_event_t* event);
+
+/* Let the recorder see the event, or drop it if a replay owns the input */
+#define ADMIT_INPUT(TYPE, ...) input_replay_admit(&(input_replay_event_t) { .type = (TYPE), .args = { __VA_ARGS__ } })
+
+/**
+ * Joystick 1 of the GLFW classes reads its axes and buttons from GLFW.joystickData and GLFW.buttonData,
+ * point them at the shared gamepad state. A disconnected gamepad reads as centered axes and released buttons.
+ */
+static void shareGamepadWithGlfw(JNIEnv* env) {
+    jclass glfw = pojav_environ->vmGlfwClass;
+    jfieldID field_joystickData = (*env)->GetStaticFieldID(env, glfw, "joystickData", "Ljava/nio/FloatBuffer;");
+    jfieldID field_buttonData = (*env)->GetStaticFieldID(env, glfw, "buttonData", "Ljava/nio/ByteBuffer;");
+    if (field_joystickData == NULL || field_buttonData == NULL) {
+        (*env)->ExceptionClear(env);
+        LOG_TO_W("<%s> %s", "NativeInput", "GLFW has no joystick buffers, gamepad unavailable");
+        return;
+    }
+    jclass byteOrderClass = (*env)->FindClass(env, "java/nio/ByteOrder");
+    jclass byteBufferClass = (*env)->FindClass(env, "java/nio/ByteBuffer");
+    jobject nativeOrder = (*env)->CallStaticObjectMethod(env, byteOrderClass,
+            (*env)->GetStaticMethodID(env, byteOrderClass, "nativeOrder", "()Ljava/nio/ByteOrder;"));
+    jobject axes = (*env)->NewDirectByteBuffer(env, pojav_environ->gamepad.state.axes, sizeof(pojav_environ->gamepad.state.axes));
+    axes = (*env)->CallObjectMethod(env, axes,
+            (*env)->GetMethodID(env, byteBufferClass, "order", "(Ljava/nio/ByteOrder;)Ljava/nio/ByteBuffer;"), nativeOrder);
+    axes = (*env)->CallObjectMethod(env, axes,
+            (*env)->GetMethodID(env, byteBufferClass, "asFloatBuffer", "()Ljava/nio/FloatBuffer;"));
+    jobject buttons = (*env)->NewDirectByteBuffer(env, pojav_environ->gamepad.state.buttons, sizeof(pojav_environ->gamepad.state.buttons));
+    if ((*env)->ExceptionCheck(env) || axes == NULL || buttons == NULL) {
+        (*env)->ExceptionClear(env);
+        LOG_TO_E("<%s> %s", "NativeInput", "Failed to share the gamepad state with GLFW");
+        return;
+    }
+    (*env)->SetStaticObjectField(env, glfw, field_joystickData, axes);
+    (*env)->SetStaticObjectField(env, glfw, field_buttonData, buttons);
+}
 
 jint JNI_OnLoad(JavaVM* vm, __attribute__((unused)) void* reserved) {
     if (pojav_environ->dalvikJavaVMPtr == NULL) {
@@ -48,6 +95,7 @@ jint JNI_OnLoad(JavaVM* vm, __attribute__((unused)) void* reserved) {
         //ZL Invoker
         pojav_environ->class_ZLInvoker = (*pojav_environ->dalvikJNIEnvPtr_ANDROID)->NewGlobalRef(pojav_environ->dalvikJNIEnvPtr_ANDROID,(*pojav_environ->dalvikJNIEnvPtr_ANDROID) ->FindClass(pojav_environ->dalvikJNIEnvPtr_ANDROID, "com/lanrhyme/shardlauncher/bridge/ZLNativeInvoker"));
         pojav_environ->method_PutFpsValue = (*pojav_environ->dalvikJNIEnvPtr_ANDROID)->GetStaticMethodID(pojav_environ->dalvikJNIEnvPtr_ANDROID, pojav_environ->class_ZLInvoker, "putFpsValue", "(I)V");
+        input_replay_set_dispatcher(dispatchInputEvent);
     } else if (pojav_environ->dalvikJavaVMPtr != vm) {
         LOG_TO_I("<%s> %s", "Native", "Saving JVM environ...");
         pojav_environ->runtimeJavaVMPtr = vm;
@@ -61,6 +109,7 @@ jint JNI_OnLoad(JavaVM* vm, __attribute__((unused)) void* reserved) {
         jfieldID field_mouseDownBuffer = (*pojav_environ->runtimeJNIEnvPtr_JRE)->GetStaticFieldID(pojav_environ->runtimeJNIEnvPtr_JRE, pojav_environ->vmGlfwClass, "mouseDownBuffer", "Ljava/nio/ByteBuffer;");
         jobject mouseDownBufferJ = (*pojav_environ->runtimeJNIEnvPtr_JRE)->GetStaticObjectField(pojav_environ->runtimeJNIEnvPtr_JRE, pojav_environ->vmGlfwClass, field_mouseDownBuffer);
         pojav_environ->mouseDownBuffer = (*pojav_environ->runtimeJNIEnvPtr_JRE)->GetDirectBufferAddress(pojav_environ->runtimeJNIEnvPtr_JRE, mouseDownBufferJ);
+        shareGamepadWithGlfw(pojav_environ->runtimeJNIEnvPtr_JRE);
         hookExec();
         installLwjglDlopenHook();
         installEMUIIteratorMititgation();
@@ -77,11 +126,96 @@ jint JNI_OnLoad(JavaVM* vm, __attribute__((unused)) void* reserved) {
     return JNI_VERSION_1_4;
 }
 
+static pthread_mutex_t windowInputLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Lock-free lookup of the input state of a window, NULL if the window has none yet */
+static GLFWWindowInput* findWindowInput(long window) {
+    if (window == 0) return NULL; // The key of the free slots
+    for (int i = 0; i < MAX_INPUT_WINDOWS; i++) {
+        GLFWWindowInput* input = atomic_load_explicit(&pojav_environ->inputWindows[i], memory_order_acquire);
+        if (input == NULL) break;
+        if (input->window == window) return input;
+    }
+    return NULL;
+}
+
+/** Find or create the input state (callback table and event queue) of a window */
+static GLFWWindowInput* obtainWindowInput(long window) {
+    GLFWWindowInput* input = findWindowInput(window);
+    if (input != NULL || window == 0) return input;
+
+    pthread_mutex_lock(&windowInputLock);
+    input = findWindowInput(window);
+    for (int i = 0; input == NULL && i < MAX_INPUT_WINDOWS; i++) {
+        GLFWWindowInput* slot = atomic_load_explicit(&pojav_environ->inputWindows[i], memory_order_relaxed);
+        if (slot != NULL) {
+            if (slot->window != 0) continue;
+            // Released by a window that went away. The event queue is drained from the game thread,
+            // which is the consumer, so whatever the old window left in it is skipped here.
+            // A producer may still hold the slot from before the release: once it's no longer the
+            // showing one, wait for any producer that got in to finish its event before the reset
+            LOG_TO_I("<%s> %s: %ld", "NativeInput", "Reusing a released input slot for window", window);
+            GLFWWindowInput* showing = slot;
+            atomic_compare_exchange_strong(&pojav_environ->showingInput, &showing, NULL);
+            // Pairs with the fence in sendData(): either it sees the slot gone, or we see it inside
+            atomic_thread_fence(memory_order_seq_cst);
+            while (atomic_load_explicit(&slot->ring.producers, memory_order_acquire) != 0) sched_yield();
+            size_t head = atomic_load_explicit(&slot->ring.head, memory_order_acquire);
+            slot->ring.pumpTarget = head;
+            atomic_store_explicit(&slot->ring.tail, head, memory_order_release);
+            input = slot;
+            atomic_store_explicit(&input->window, window, memory_order_release);
+        } else {
+            if (posix_memalign((void**) &input, CACHE_LINE_SIZE, sizeof(GLFWWindowInput)) != 0) {
+                input = NULL;
+                break;
+            }
+            memset(input, 0, sizeof(GLFWWindowInput));
+            input->window = window;
+            // Publish the fully initialized state to the lock-free readers
+            atomic_store_explicit(&pojav_environ->inputWindows[i], input, memory_order_release);
+        }
+        if (window == pojav_environ->showingWindow)
+            atomic_store_explicit(&pojav_environ->showingInput, input, memory_order_release);
+    }
+    pthread_mutex_unlock(&windowInputLock);
+
+    if (input == NULL) LOG_TO_E("<%s> %s: %ld", "NativeInput", "No room left for the input of window, ignoring its callbacks", window);
+    return input;
+}
+
+/**
+ * Give the slot of a window back once it has no callbacks left, which is what glfwFreeCallbacks()
+ * does before the window is destroyed. The memory stays allocated: the Android side may still
+ * hold the pointer, so it is only ever reused for another window.
+ */
+static void releaseWindowInput(GLFWWindowInput* input) {
+    pthread_mutex_lock(&windowInputLock);
+    GLFWWindowInput* showing = input;
+    atomic_compare_exchange_strong(&pojav_environ->showingInput, &showing, NULL);
+    input->window = 0;
+    pthread_mutex_unlock(&windowInputLock);
+}
+
+/** The input state events coming from Android go to, NULL until the showing window registered a callback */
+static inline GLFWWindowInput* showingWindowInput() {
+    return atomic_load_explicit(&pojav_environ->showingInput, memory_order_acquire);
+}
+
+static bool hasCallbacks(const GLFWWindowInput* input) {
+    return input->GLFW_invoke_Char || input->GLFW_invoke_CharMods || input->GLFW_invoke_CursorEnter
+        || input->GLFW_invoke_CursorPos || input->GLFW_invoke_FramebufferSize || input->GLFW_invoke_Key
+        || input->GLFW_invoke_MouseButton || input->GLFW_invoke_Scroll || input->GLFW_invoke_WindowSize;
+}
+
 #define ADD_CALLBACK_WWIN(NAME) \
 JNIEXPORT jlong JNICALL Java_org_lwjgl_glfw_GLFW_nglfwSet##NAME##Callback(JNIEnv * env, jclass cls, jlong window, jlong callbackptr) { \
-    void** oldCallback = (void**) &pojav_environ->GLFW_invoke_##NAME; \
-    pojav_environ->GLFW_invoke_##NAME = (GLFW_invoke_##NAME##_func*) (uintptr_t) callbackptr; \
-    return (jlong) (uintptr_t) *oldCallback; \
+    GLFWWindowInput* input = obtainWindowInput((long) window); \
+    if (input == NULL) return 0; \
+    GLFW_invoke_##NAME##_func* oldCallback = input->GLFW_invoke_##NAME; \
+    input->GLFW_invoke_##NAME = (GLFW_invoke_##NAME##_func*) (uintptr_t) callbackptr; \
+    if (callbackptr == 0 && !hasCallbacks(input)) releaseWindowInput(input); \
+    return (jlong) (uintptr_t) oldCallback; \
 }
 
 ADD_CALLBACK_WWIN(Char)
@@ -101,65 +235,135 @@ void handleFramebufferSizeJava(long window, int w, int h) {
 }
 
 void pojavPumpEvents(void* window) {
-    if(pojav_environ->shouldUpdateMouse) {
-        pojav_environ->GLFW_invoke_CursorPos(window, floor(pojav_environ->cursorX),
-                                             floor(pojav_environ->cursorY));
+    GLFWWindowInput* input = findWindowInput((long) window);
+    if (input == NULL) return;
+
+    // The cursor belongs to the showing window. In history mode the samples come in order through the queue instead
+    if(pojav_environ->shouldUpdateMouse && input == showingWindowInput()) {
+        if (pojav_environ->rawMotion.pending) {
+            // Raw motion keeps its sub-pixel part, like GLFW does
+            input->GLFW_invoke_CursorPos(window, pojav_environ->cursorX, pojav_environ->cursorY);
+        } else {
+            input->GLFW_invoke_CursorPos(window, floor(pojav_environ->cursorX),
+                                         floor(pojav_environ->cursorY));
+        }
     }
 
-    size_t index = pojav_environ->outEventIndex;
-    size_t targetIndex = pojav_environ->outTargetIndex;
+    int framebufferWidth, framebufferHeight;
+    if (input == showingWindowInput() && input->GLFW_invoke_FramebufferSize
+        && render_scale_take_resize(&framebufferWidth, &framebufferHeight))
+        input->GLFW_invoke_FramebufferSize(window, framebufferWidth, framebufferHeight);
+
+    GLFWInputRing* ring = &input->ring;
+    // The consumer owns the tail, no need to synchronize with ourselves
+    size_t index = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t targetIndex = ring->pumpTarget;
+    size_t cursorSkip = ring->pumpCursorSkip;
 
     while (targetIndex != index) {
-        GLFWInputEvent event = pojav_environ->events[index];
+        GLFWInputEvent event = ring->events[index & (EVENT_WINDOW_SIZE - 1)];
+        input_latency_on_delivered(event.time);
         switch (event.type) {
             case EVENT_TYPE_CHAR:
-                if(pojav_environ->GLFW_invoke_Char) pojav_environ->GLFW_invoke_Char(window, event.i1);
+                if(input->GLFW_invoke_Char) input->GLFW_invoke_Char(window, event.i1);
                 break;
             case EVENT_TYPE_CHAR_MODS:
-                if(pojav_environ->GLFW_invoke_CharMods) pojav_environ->GLFW_invoke_CharMods(window, event.i1, event.i2);
+                if(input->GLFW_invoke_CharMods) input->GLFW_invoke_CharMods(window, event.i1, event.i2);
+                break;
+            case EVENT_TYPE_CURSOR_ENTER:
+                if(input->GLFW_invoke_CursorEnter) input->GLFW_invoke_CursorEnter(window, event.i1);
+                break;
+            case EVENT_TYPE_CURSOR_POS:
+                pojav_environ->cursorX = event.x;
+                pojav_environ->cursorY = event.y;
+                // Only the newest samples are replayed, the older ones are superseded anyway
+                if (cursorSkip > 0) {
+                    cursorSkip--;
+                    break;
+                }
+                if(input->GLFW_invoke_CursorPos) input->GLFW_invoke_CursorPos(window, floor(event.x), floor(event.y));
                 break;
             case EVENT_TYPE_KEY:
-                if(pojav_environ->GLFW_invoke_Key) pojav_environ->GLFW_invoke_Key(window, event.i1, event.i2, event.i3, event.i4);
+                if(input->GLFW_invoke_Key) input->GLFW_invoke_Key(window, event.i1, event.i2, event.i3, event.i4);
                 break;
             case EVENT_TYPE_MOUSE_BUTTON:
-                if(pojav_environ->GLFW_invoke_MouseButton) pojav_environ->GLFW_invoke_MouseButton(window, event.i1, event.i2, event.i3);
+                if(input->GLFW_invoke_MouseButton) input->GLFW_invoke_MouseButton(window, event.i1, event.i2, event.i3);
                 break;
             case EVENT_TYPE_SCROLL:
-                if(pojav_environ->GLFW_invoke_Scroll) pojav_environ->GLFW_invoke_Scroll(window, event.i1, event.i2);
-                break;
-            case EVENT_TYPE_FRAMEBUFFER_SIZE:
-                handleFramebufferSizeJava(pojav_environ->showingWindow, event.i1, event.i2);
-                if(pojav_environ->GLFW_invoke_FramebufferSize) pojav_environ->GLFW_invoke_FramebufferSize(window, event.i1, event.i2);
+                if(input->GLFW_invoke_Scroll) input->GLFW_invoke_Scroll(window, event.i1, event.i2);
                 break;
+            case EVENT_TYPE_FRAMEBUFFER_SIZE: {
+                // The render scale shrinks the framebuffer, never the window
+                int width, height;
+                render_scale_apply(event.i1, event.i2, &width, &height);
+                if (width == event.i1 && height == event.i2) handleFramebufferSizeJava(input->window, width, height);
+                if(input->GLFW_invoke_FramebufferSize) input->GLFW_invoke_FramebufferSize(window, width, height);
+            } break;
             case EVENT_TYPE_WINDOW_SIZE:
-                handleFramebufferSizeJava(pojav_environ->showingWindow, event.i1, event.i2);
-                if(pojav_environ->GLFW_invoke_WindowSize) pojav_environ->GLFW_invoke_WindowSize(window, event.i1, event.i2);
+                handleFramebufferSizeJava(input->window, event.i1, event.i2);
+                if(input->GLFW_invoke_WindowSize) input->GLFW_invoke_WindowSize(window, event.i1, event.i2);
                 break;
         }
 
         index++;
-        if (index >= EVENT_WINDOW_SIZE)
-            index -= EVENT_WINDOW_SIZE;
     }
 
-    // The out target index is updated by the rewinder
+    // Hand the slots back right away, so pumping the same window twice in a round delivers nothing twice.
+    // Release so that the producer can't reuse a slot before we are done reading it
+    atomic_store_explicit(&ring->tail, targetIndex, memory_order_release);
+}
+
+/** Count the cursor samples of this round so that only the newest cursorHistoryDepth of them get replayed */
+static size_t countExcessCursorSamples(GLFWInputRing* ring) {
+    size_t samples = 0;
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    for (size_t index = tail; index != ring->pumpTarget; index++) {
+        if (ring->events[index & (EVENT_WINDOW_SIZE - 1)].type == EVENT_TYPE_CURSOR_POS) samples++;
+    }
+    size_t depth = (size_t) pojav_environ->cursorHistoryDepth;
+    return samples > depth ? samples - depth : 0;
 }
 
 /** Prepare the library for sending out callbacks to all windows */
 void pojavStartPumping() {
-    size_t counter = atomic_load_explicit(&pojav_environ->eventCounter, memory_order_acquire);
-    size_t index = pojav_environ->outEventIndex;
-
-    unsigned targetIndex = index + counter;
-    if (targetIndex >= EVENT_WINDOW_SIZE)
-        targetIndex -= EVENT_WINDOW_SIZE;
+    bool historyMode = pojav_environ->cursorMotionMode == CURSOR_MOTION_HISTORY;
+    for (int i = 0; i < MAX_INPUT_WINDOWS; i++) {
+        GLFWWindowInput* input = atomic_load_explicit(&pojav_environ->inputWindows[i], memory_order_acquire);
+        if (input == NULL) break;
+        GLFWInputRing* ring = &input->ring;
+        // Pairs with the release in sendData(), every event before the head is fully written
+        // Only accessed by one unique thread, no need for atomic store
+        ring->pumpTarget = atomic_load_explicit(&ring->head, memory_order_acquire);
+        ring->pumpCursorSkip = historyMode ? countExcessCursorSamples(ring) : 0;
+    }
 
-    // Only accessed by one unique thread, no need for atomic store
-    pojav_environ->inEventCount = counter;
-    pojav_environ->outTargetIndex = targetIndex;
+    // Move the game's cursor to where Android last put it, then by everything accumulated since the last round
+    GLFWWindowInput* input = showingWindowInput();
+    GLFWRawMotion* raw = &pojav_environ->rawMotion;
+    // Pairs with the release in publishCursorPos(), position is at least as new as the serial
+    unsigned positionSerial = atomic_load_explicit(&raw->positionSerial, memory_order_acquire);
+    if (positionSerial != raw->consumedPositionSerial) {
+        raw->consumedPositionSerial = positionSerial;
+        GLFWInputEvent position;
+        uint64_t packed = atomic_load_explicit(&raw->position, memory_order_relaxed);
+        memcpy(&position.x, &packed, sizeof(packed));
+        pojav_environ->cursorX = position.x;
+        pojav_environ->cursorY = position.y;
+    }
+    double totalX = atomic_load_explicit(&raw->totalX, memory_order_relaxed);
+    double totalY = atomic_load_explicit(&raw->totalY, memory_order_relaxed);
+    raw->pending = totalX != raw->consumedX || totalY != raw->consumedY;
+    if (raw->pending) {
+        pojav_environ->cLastX = pojav_environ->cursorX += totalX - raw->consumedX;
+        pojav_environ->cLastY = pojav_environ->cursorY += totalY - raw->consumedY;
+        raw->consumedX = totalX;
+        raw->consumedY = totalY;
+        pojav_environ->shouldUpdateMouse = input && input->GLFW_invoke_CursorPos;
+    }
+    if (historyMode) return;
 
     //PumpEvents is called for every window, so this logic should be there in order to correctly distribute events to all windows.
-    if((pojav_environ->cLastX != pojav_environ->cursorX || pojav_environ->cLastY != pojav_environ->cursorY) && pojav_environ->GLFW_invoke_CursorPos) {
+    if((pojav_environ->cLastX != pojav_environ->cursorX || pojav_environ->cLastY != pojav_environ->cursorY) && input && input->GLFW_invoke_CursorPos) {
         pojav_environ->cLastX = pojav_environ->cursorX;
         pojav_environ->cLastY = pojav_environ->cursorY;
         pojav_environ->shouldUpdateMouse = true;
@@ -168,10 +372,7 @@ void pojavStartPumping() {
 
 /** Prepare the library for the next round of new events */
 void pojavStopPumping() {
-    pojav_environ->outEventIndex = pojav_environ->outTargetIndex;
-
-    // New events may have arrived while pumping, so remove only the difference before the start and end of execution
-    atomic_fetch_sub_explicit(&pojav_environ->eventCounter, pojav_environ->inEventCount, memory_order_acquire);
+    // Events that arrived while pumping stay queued, each window already handed back what it consumed
     // Make sure the next frame won't send mouse updates if it's unnecessary
     pojav_environ->shouldUpdateMouse = false;
 }
@@ -195,6 +396,11 @@ Java_org_lwjgl_glfw_GLFW_nglfwGetCursorPosA(JNIEnv *env, __attribute__((unused))
     (*env)->SetDoubleArrayRegion(env, ypos, 0,1, &pojav_environ->cursorY);
 }
 
+JNIEXPORT jobject JNICALL
+Java_org_lwjgl_glfw_CallbackBridge_nativeGetGamepadBuffer(JNIEnv* env, __attribute__((unused)) jclass clazz) {
+    return (*env)->NewDirectByteBuffer(env, &pojav_environ->gamepad, sizeof(GLFWGamepadShared));
+}
+
 JNIEXPORT void JNICALL JavaCritical_org_lwjgl_glfw_GLFW_glfwSetCursorPos(__attribute__((unused)) jlong window, jdouble xpos,
                                                                          jdouble ypos) {
     pojav_environ->cLastX = pojav_environ->cursorX = xpos;
@@ -209,18 +415,64 @@ Java_org_lwjgl_glfw_GLFW_glfwSetCursorPos(__attribute__((unused)) JNIEnv *env, _
 
 
 
-void sendData(int type, int i1, int i2, int i3, int i4) {
-    GLFWInputEvent *event = &pojav_environ->events[pojav_environ->inEventIndex];
+/** Motion can be dropped under pressure, the next sample supersedes it anyway */
+static inline bool isMotionEvent(int type) {
+    return type == EVENT_TYPE_CURSOR_POS || type == EVENT_TYPE_SCROLL;
+}
+
+/** Put an event in the ring of a window, unless it's full */
+static bool enqueueEvent(GLFWInputRing* ring, int type, int i1, int i2, int i3, int i4) {
+    bool isMotion = isMotionEvent(type);
+    // The producer owns the head, no need to synchronize with ourselves
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    size_t capacity = EVENT_WINDOW_SIZE;
+    if (isMotion && pojav_environ->inputOverflowPolicy == INPUT_OVERFLOW_DROP_MOTION)
+        capacity -= EVENT_EDGE_RESERVE;
+
+    if (head - ring->cachedTail >= capacity) {
+        // Only touch the consumer cache line when the queue looks full
+        ring->cachedTail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (head - ring->cachedTail >= capacity) {
+            if (isMotion) {
+                atomic_fetch_add_explicit(&ring->droppedMotion, 1, memory_order_relaxed);
+            } else if (atomic_fetch_add_explicit(&ring->droppedEdges, 1, memory_order_relaxed) == 0) {
+                LOG_TO_W("<%s> %s", "NativeInput", "Input queue is full, key and button events are being dropped!");
+            }
+            return false;
+        }
+    }
+
+    GLFWInputEvent *event = &ring->events[head & (EVENT_WINDOW_SIZE - 1)];
     event->type = type;
     event->i1 = i1;
     event->i2 = i2;
     event->i3 = i3;
     event->i4 = i4;
+    event->time = telemetry_now_ns();
 
-    if (++pojav_environ->inEventIndex >= EVENT_WINDOW_SIZE)
-        pojav_environ->inEventIndex -= EVENT_WINDOW_SIZE;
+    // Publish the event, pairs with the acquire in pojavStartPumping()
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return true;
+}
 
-    atomic_fetch_add_explicit(&pojav_environ->eventCounter, 1, memory_order_acquire);
+/**
+ * Queue an event for the showing window, it gets delivered on the next pump round.
+ * Must only be called from a single producer thread.
+ * @return false if the event was dropped because the queue is full
+ */
+bool sendData(int type, int i1, int i2, int i3, int i4) {
+    GLFWWindowInput* input = showingWindowInput();
+    if (input == NULL) return false;
+    GLFWInputRing* ring = &input->ring;
+    // The slot may have been handed to another window since it was loaded, check again once inside,
+    // obtainWindowInput() waits for us before reusing it
+    atomic_fetch_add_explicit(&ring->producers, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    bool queued = atomic_load_explicit(&pojav_environ->showingInput, memory_order_relaxed) == input
+               && enqueueEvent(ring, type, i1, i2, i3, i4);
+    atomic_fetch_sub_explicit(&ring->producers, 1, memory_order_release);
+    return queued;
 }
 
 /**
@@ -268,13 +520,51 @@ void noncritical_set_stackqueue(__attribute__((unused)) JNIEnv *env, __attribute
     critical_set_stackqueue(use_input_stack_queue);
 }
 
+void critical_set_input_overflow_policy(jint policy) {
+    if (policy != INPUT_OVERFLOW_DROP_MOTION && policy != INPUT_OVERFLOW_DROP_NEWEST) {
+        LOG_TO_W("<%s> %s: %i", "NativeInput", "Unknown input overflow policy", policy);
+        return;
+    }
+    pojav_environ->inputOverflowPolicy = policy;
+}
+
+void noncritical_set_input_overflow_policy(__attribute__((unused)) JNIEnv *env, __attribute__((unused)) jclass clazz, jint policy) {
+    critical_set_input_overflow_policy(policy);
+}
+
+void critical_set_cursor_motion_mode(jint mode, jint historyDepth) {
+    if (mode < CURSOR_MOTION_DIRECT || mode > CURSOR_MOTION_HISTORY || historyDepth < 1) {
+        LOG_TO_W("<%s> %s: %i (%i)", "NativeInput", "Invalid cursor motion mode", mode, historyDepth);
+        return;
+    }
+    pojav_environ->cursorHistoryDepth = historyDepth;
+    pojav_environ->cursorMotionMode = mode;
+}
+
+void noncritical_set_cursor_motion_mode(__attribute__((unused)) JNIEnv *env, __attribute__((unused)) jclass clazz, jint mode, jint historyDepth) {
+    critical_set_cursor_motion_mode(mode, historyDepth);
+}
+
 JNIEXPORT jstring JNICALL Java_org_lwjgl_glfw_CallbackBridge_nativeClipboard(JNIEnv* env, __attribute__((unused)) jclass clazz, jint action, jbyteArray copySrc) {
 #ifdef DEBUG
     LOGD("Debug: Clipboard access is going on\n", pojav_environ->isUseStackQueueCall);
 #endif
 
-    JNIEnv *dalvikEnv;
-    (*pojav_environ->dalvikJavaVMPtr)->AttachCurrentThread(pojav_environ->dalvikJavaVMPtr, &dalvikEnv, NULL);
+    if (action != CLIPBOARD_PASTE) {
+        // Copying and opening return nothing, no need to wait for the UI
+        char* text = NULL;
+        if (copySrc) {
+            jsize length = (*env)->GetArrayLength(env, copySrc);
+            text = malloc(length + 1);
+            if (text == NULL) return NULL;
+            (*env)->GetByteArrayRegion(env, copySrc, 0, length, (jbyte*) text);
+            text[length] = '\0';
+        }
+        upcall_post(UPCALL_CLIPBOARD, action, text);
+        return NULL;
+    }
+
+    JNIEnv *dalvikEnv = jni_attach_env(pojav_environ->dalvikJavaVMPtr);
     assert(dalvikEnv != NULL);
     assert(pojav_environ->bridgeClazz != NULL);
     
@@ -293,7 +583,6 @@ JNIEXPORT jstring JNICALL Java_org_lwjgl_glfw_CallbackBridge_nativeClipboard(JNI
         (*dalvikEnv)->DeleteLocalRef(dalvikEnv, copyDst);    
         (*env)->ReleaseByteArrayElements(env, copySrc, (jbyte *)copySrcC, 0);
     }
-    (*pojav_environ->dalvikJavaVMPtr)->DetachCurrentThread(pojav_environ->dalvikJavaVMPtr);
     return pasteDst;
 }
 
@@ -303,6 +592,7 @@ JNIEXPORT jboolean JNICALL JavaCritical_org_lwjgl_glfw_CallbackBridge_nativeSetI
 #endif
     LOG_TO_I("<%s> %s: %i", "NativeInput", "Input ready", inputReady);
     pojav_environ->isInputReady = inputReady;
+    if (inputReady) input_replay_start_from_env();
     return pojav_environ->isUseStackQueueCall;
 }
 
@@ -311,27 +601,23 @@ JNIEXPORT jboolean JNICALL Java_org_lwjgl_glfw_CallbackBridge_nativeSetInputRead
 }
 
 JNIEXPORT void JNICALL Java_org_lwjgl_glfw_CallbackBridge_nativeSetGrabbing(__attribute__((unused)) JNIEnv* env, __attribute__((unused)) jclass clazz, jboolean grabbing) {
-    JNIEnv *dalvikEnv;
-    (*pojav_environ->dalvikJavaVMPtr)->AttachCurrentThread(pojav_environ->dalvikJavaVMPtr, &dalvikEnv, NULL);
-    (*dalvikEnv)->CallStaticVoidMethod(dalvikEnv, pojav_environ->bridgeClazz, pojav_environ->method_onGrabStateChanged, grabbing);
-    (*pojav_environ->dalvikJavaVMPtr)->DetachCurrentThread(pojav_environ->dalvikJavaVMPtr);
+    upcall_post(UPCALL_GRAB_STATE, grabbing, NULL);
     pojav_environ->isGrabbing = grabbing;
 }
 
 JNIEXPORT void JNICALL
 Java_org_lwjgl_glfw_CallbackBridge_nativeSetCursorShape(__attribute__((unused)) JNIEnv* env, __attribute__((unused)) jclass clazz, jint shape) {
-    JNIEnv *dalvikEnv;
-    (*pojav_environ->dalvikJavaVMPtr)->AttachCurrentThread(pojav_environ->dalvikJavaVMPtr, &dalvikEnv, NULL);
-    (*dalvikEnv)->CallStaticVoidMethod(dalvikEnv, pojav_environ->bridgeClazz, pojav_environ->method_onCursorShapeChanged, shape);
-    (*pojav_environ->dalvikJavaVMPtr)->DetachCurrentThread(pojav_environ->dalvikJavaVMPtr);
+    upcall_post(UPCALL_CURSOR_SHAPE, shape, NULL);
 }
 
 jboolean critical_send_char(jchar codepoint) {
-    if (pojav_environ->GLFW_invoke_Char && pojav_environ->isInputReady) {
+    if (!ADMIT_INPUT(EVENT_TYPE_CHAR, { .i = codepoint })) return JNI_FALSE;
+    GLFWWindowInput* input = showingWindowInput();
+    if (input && input->GLFW_invoke_Char && pojav_environ->isInputReady) {
         if (pojav_environ->isUseStackQueueCall) {
             sendData(EVENT_TYPE_CHAR, codepoint, 0, 0, 0);
         } else {
-            pojav_environ->GLFW_invoke_Char((void*) pojav_environ->showingWindow, (unsigned int) codepoint);
+            input->GLFW_invoke_Char((void*) input->window, (unsigned int) codepoint);
         }
         return JNI_TRUE;
     }
@@ -343,11 +629,13 @@ jboolean noncritical_send_char(__attribute__((unused)) JNIEnv* env, __attribute_
 }
 
 jboolean critical_send_char_mods(jchar codepoint, jint mods) {
-    if (pojav_environ->GLFW_invoke_CharMods && pojav_environ->isInputReady) {
+    if (!ADMIT_INPUT(EVENT_TYPE_CHAR_MODS, { .i = codepoint }, { .i = mods })) return JNI_FALSE;
+    GLFWWindowInput* input = showingWindowInput();
+    if (input && input->GLFW_invoke_CharMods && pojav_environ->isInputReady) {
         if (pojav_environ->isUseStackQueueCall) {
             sendData(EVENT_TYPE_CHAR_MODS, (int) codepoint, mods, 0, 0);
         } else {
-            pojav_environ->GLFW_invoke_CharMods((void*) pojav_environ->showingWindow, codepoint, mods);
+            input->GLFW_invoke_CharMods((void*) input->window, codepoint, mods);
         }
         return JNI_TRUE;
     }
@@ -365,21 +653,33 @@ JNIEXPORT void JNICALL Java_org_lwjgl_glfw_CallbackBridge_nativeSendCursorEnter(
 }
 */
 
+/** Hand an absolute position to the game thread, which is the only one moving the cursor */
+static void publishCursorPos(jfloat x, jfloat y) {
+    GLFWRawMotion* raw = &pojav_environ->rawMotion;
+    GLFWInputEvent position = { .x = x, .y = y };
+    uint64_t packed;
+    memcpy(&packed, &position.x, sizeof(packed));
+    atomic_store_explicit(&raw->position, packed, memory_order_relaxed);
+    atomic_fetch_add_explicit(&raw->positionSerial, 1, memory_order_release);
+}
+
 void critical_send_cursor_pos(jfloat x, jfloat y) {
+    if (!ADMIT_INPUT(EVENT_TYPE_CURSOR_POS, { .f = x }, { .f = y })) return;
+    GLFWWindowInput* input = showingWindowInput();
 #ifdef DEBUG
     LOGD("Sending cursor position \n");
 #endif
-    if (pojav_environ->GLFW_invoke_CursorPos && pojav_environ->isInputReady) {
+    if (input && input->GLFW_invoke_CursorPos && pojav_environ->isInputReady) {
 #ifdef DEBUG
-        LOGD("pojav_environ->GLFW_invoke_CursorPos && pojav_environ->isInputReady \n");
+        LOGD("input->GLFW_invoke_CursorPos && pojav_environ->isInputReady \n");
 #endif
         if (!pojav_environ->isCursorEntered) {
-            if (pojav_environ->GLFW_invoke_CursorEnter) {
+            if (input->GLFW_invoke_CursorEnter) {
                 pojav_environ->isCursorEntered = true;
                 if (pojav_environ->isUseStackQueueCall) {
                     sendData(EVENT_TYPE_CURSOR_ENTER, 1, 0, 0, 0);
                 } else {
-                    pojav_environ->GLFW_invoke_CursorEnter((void*) pojav_environ->showingWindow, 1);
+                    input->GLFW_invoke_CursorEnter((void*) input->window, 1);
                 }
             } else if (pojav_environ->isGrabbing) {
                 // Some Minecraft versions does not use GLFWCursorEnterCallback
@@ -388,11 +688,21 @@ void critical_send_cursor_pos(jfloat x, jfloat y) {
             }
         }
 
-        if (!pojav_environ->isUseStackQueueCall) {
-            pojav_environ->GLFW_invoke_CursorPos((void*) pojav_environ->showingWindow, (double) (x), (double) (y));
-        } else {
-            pojav_environ->cursorX = x;
-            pojav_environ->cursorY = y;
+        switch (pojav_environ->cursorMotionMode) {
+            case CURSOR_MOTION_HISTORY: {
+                // The game thread moves the cursor as it replays the samples
+                GLFWInputEvent sample = { .x = x, .y = y };
+                sendData(EVENT_TYPE_CURSOR_POS, sample.i1, sample.i2, 0, 0);
+            } break;
+            case CURSOR_MOTION_COALESCE:
+                publishCursorPos(x, y);
+                break;
+            default:
+                if (!pojav_environ->isUseStackQueueCall) {
+                    input->GLFW_invoke_CursorPos((void*) input->window, (double) (x), (double) (y));
+                } else {
+                    publishCursorPos(x, y);
+                }
         }
     }
 }
@@ -400,17 +710,39 @@ void critical_send_cursor_pos(jfloat x, jfloat y) {
 void noncritical_send_cursor_pos(__attribute__((unused)) JNIEnv* env, __attribute__((unused)) jclass clazz,  jfloat x, jfloat y) {
     critical_send_cursor_pos(x, y);
 }
+
+/**
+ * Relative motion for the grabbed cursor. Unlike positions, nothing of it is rounded or superseded:
+ * it is summed up and the game thread applies the sum once per pump, even without the stack queue,
+ * as it's the one that owns the cursor position.
+ */
+void critical_send_cursor_delta(jfloat dx, jfloat dy) {
+    if (!ADMIT_INPUT(EVENT_TYPE_CURSOR_DELTA, { .f = dx }, { .f = dy })) return;
+    GLFWWindowInput* input = showingWindowInput();
+    if (input && input->GLFW_invoke_CursorPos && pojav_environ->isInputReady) {
+        // Only this thread writes the totals, a plain load and store is enough
+        GLFWRawMotion* raw = &pojav_environ->rawMotion;
+        atomic_store_explicit(&raw->totalX, atomic_load_explicit(&raw->totalX, memory_order_relaxed) + dx, memory_order_relaxed);
+        atomic_store_explicit(&raw->totalY, atomic_load_explicit(&raw->totalY, memory_order_relaxed) + dy, memory_order_relaxed);
+    }
+}
+
+void noncritical_send_cursor_delta(__attribute__((unused)) JNIEnv* env, __attribute__((unused)) jclass clazz, jfloat dx, jfloat dy) {
+    critical_send_cursor_delta(dx, dy);
+}
 #define max(a,b) \
    ({ __typeof__ (a) _a = (a); \
        __typeof__ (b) _b = (b); \
      _a > _b ? _a : _b; })
 void critical_send_key(jint key, jint scancode, jint action, jint mods) {
-    if (pojav_environ->GLFW_invoke_Key && pojav_environ->isInputReady) {
+    if (!ADMIT_INPUT(EVENT_TYPE_KEY, { .i = key }, { .i = scancode }, { .i = action }, { .i = mods })) return;
+    GLFWWindowInput* input = showingWindowInput();
+    if (input && input->GLFW_invoke_Key && pojav_environ->isInputReady) {
         pojav_environ->keyDownBuffer[max(0, key-31)] = (jbyte) action;
         if (pojav_environ->isUseStackQueueCall) {
             sendData(EVENT_TYPE_KEY, key, scancode, action, mods);
         } else {
-            pojav_environ->GLFW_invoke_Key((void*) pojav_environ->showingWindow, key, scancode, action, mods);
+            input->GLFW_invoke_Key((void*) input->window, key, scancode, action, mods);
         }
     }
 }
@@ -419,12 +751,14 @@ void noncritical_send_key(__attribute__((unused)) JNIEnv* env, __attribute__((un
 }
 
 void critical_send_mouse_button(jint button, jint action, jint mods) {
-    if (pojav_environ->GLFW_invoke_MouseButton && pojav_environ->isInputReady) {
+    if (!ADMIT_INPUT(EVENT_TYPE_MOUSE_BUTTON, { .i = button }, { .i = action }, { .i = mods })) return;
+    GLFWWindowInput* input = showingWindowInput();
+    if (input && input->GLFW_invoke_MouseButton && pojav_environ->isInputReady) {
         pojav_environ->mouseDownBuffer[max(0, button)] = (jbyte) action;
         if (pojav_environ->isUseStackQueueCall) {
             sendData(EVENT_TYPE_MOUSE_BUTTON, button, action, mods, 0);
         } else {
-            pojav_environ->GLFW_invoke_MouseButton((void*) pojav_environ->showingWindow, button, action, mods);
+            input->GLFW_invoke_MouseButton((void*) input->window, button, action, mods);
         }
     }
 }
@@ -434,22 +768,26 @@ void noncritical_send_mouse_button(__attribute__((unused)) JNIEnv* env, __attrib
 }
 
 void critical_send_screen_size(jint width, jint height) {
+    if (!ADMIT_INPUT(EVENT_TYPE_WINDOW_SIZE, { .i = width }, { .i = height })) return;
+    GLFWWindowInput* input = showingWindowInput();
     pojav_environ->savedWidth = width;
     pojav_environ->savedHeight = height;
-    if (pojav_environ->isInputReady) {
-        if (pojav_environ->GLFW_invoke_FramebufferSize) {
+    if (input && pojav_environ->isInputReady) {
+        if (input->GLFW_invoke_FramebufferSize) {
             if (pojav_environ->isUseStackQueueCall) {
                 sendData(EVENT_TYPE_FRAMEBUFFER_SIZE, width, height, 0, 0);
             } else {
-                pojav_environ->GLFW_invoke_FramebufferSize((void*) pojav_environ->showingWindow, width, height);
+                int framebufferWidth, framebufferHeight;
+                render_scale_apply(width, height, &framebufferWidth, &framebufferHeight);
+                input->GLFW_invoke_FramebufferSize((void*) input->window, framebufferWidth, framebufferHeight);
             }
         }
 
-        if (pojav_environ->GLFW_invoke_WindowSize) {
+        if (input->GLFW_invoke_WindowSize) {
             if (pojav_environ->isUseStackQueueCall) {
                 sendData(EVENT_TYPE_WINDOW_SIZE, width, height, 0, 0);
             } else {
-                pojav_environ->GLFW_invoke_WindowSize((void*) pojav_environ->showingWindow, width, height);
+                input->GLFW_invoke_WindowSize((void*) input->window, width, height);
             }
         }
     }
@@ -460,11 +798,13 @@ void noncritical_send_screen_size(__attribute__((unused)) JNIEnv* env, __attribu
 }
 
 void critical_send_scroll(jdouble xoffset, jdouble yoffset) {
-    if (pojav_environ->GLFW_invoke_Scroll && pojav_environ->isInputReady) {
+    if (!ADMIT_INPUT(EVENT_TYPE_SCROLL, { .f = (float) xoffset }, { .f = (float) yoffset })) return;
+    GLFWWindowInput* input = showingWindowInput();
+    if (input && input->GLFW_invoke_Scroll && pojav_environ->isInputReady) {
         if (pojav_environ->isUseStackQueueCall) {
             sendData(EVENT_TYPE_SCROLL, (int)xoffset, (int)yoffset, 0, 0);
         } else {
-            pojav_environ->GLFW_invoke_Scroll((void*) pojav_environ->showingWindow, (double) xoffset, (double) yoffset);
+            input->GLFW_invoke_Scroll((void*) input->window, (double) xoffset, (double) yoffset);
         }
     }
 }
@@ -473,9 +813,82 @@ void noncritical_send_scroll(__attribute__((unused)) JNIEnv* env, __attribute__(
     critical_send_scroll(xoffset, yoffset);
 }
 
+/*
+ * One record of the batch buffer shared with CallbackBridge. The layout must match
+ * CallbackBridge.BATCH_RECORD_SIZE: an int type followed by four 32-bit arguments,
+ * which are floats for EVENT_TYPE_CURSOR_POS, EVENT_TYPE_CURSOR_DELTA and EVENT_TYPE_SCROLL and ints otherwise.
+ * Recorded input uses the very same records.
+ */
+typedef input_replay_event_t GLFWInputBatchRecord;
+_Static_assert(sizeof(GLFWInputBatchRecord) == 20, "Batch record layout must match CallbackBridge");
+
+JNIEXPORT void JNICALL
+Java_org_lwjgl_glfw_CallbackBridge_nativeRegisterInputBatch(JNIEnv* env, __attribute__((unused)) jclass clazz, jobject buffer) {
+    void* address = (*env)->GetDirectBufferAddress(env, buffer);
+    jlong capacity = (*env)->GetDirectBufferCapacity(env, buffer);
+    if (address == NULL || capacity < (jlong) sizeof(GLFWInputBatchRecord)) {
+        LOG_TO_E("<%s> %s", "NativeInput", "Input batch buffer is not a usable direct buffer");
+        return;
+    }
+    pojav_environ->inputBatchCapacity = (int) (capacity / (jlong) sizeof(GLFWInputBatchRecord));
+    pojav_environ->inputBatchBuffer = address;
+}
+
+/** Send a batch or replay record through the regular send path of its type */
+static void dispatchInputEvent(const GLFWInputBatchRecord* record) {
+    switch (record->type) {
+        case EVENT_TYPE_CHAR:
+            critical_send_char((jchar) record->args[0].i);
+            break;
+        case EVENT_TYPE_CHAR_MODS:
+            critical_send_char_mods((jchar) record->args[0].i, record->args[1].i);
+            break;
+        case EVENT_TYPE_CURSOR_POS:
+            critical_send_cursor_pos(record->args[0].f, record->args[1].f);
+            break;
+        case EVENT_TYPE_CURSOR_DELTA:
+            critical_send_cursor_delta(record->args[0].f, record->args[1].f);
+            break;
+        case EVENT_TYPE_KEY:
+            critical_send_key(record->args[0].i, record->args[1].i, record->args[2].i, record->args[3].i);
+            break;
+        case EVENT_TYPE_MOUSE_BUTTON:
+            critical_send_mouse_button(record->args[0].i, record->args[1].i, record->args[2].i);
+            break;
+        case EVENT_TYPE_SCROLL:
+            critical_send_scroll(record->args[0].f, record->args[1].f);
+            break;
+        case EVENT_TYPE_WINDOW_SIZE:
+            critical_send_screen_size(record->args[0].i, record->args[1].i);
+            break;
+        default:
+            LOG_TO_W("<%s> %s: %i", "NativeInput", "Unknown input record type", record->type);
+    }
+}
+
+/**
+ * Dispatch a whole batch of records through the regular send paths with a single JNI crossing.
+ * @return how many records were read
+ */
+jint critical_submit_batch(jint count) {
+    const GLFWInputBatchRecord* records = pojav_environ->inputBatchBuffer;
+    if (records == NULL) return 0;
+    if (count > pojav_environ->inputBatchCapacity) count = pojav_environ->inputBatchCapacity;
+    if (count < 0) count = 0;
+
+    for (jint i = 0; i < count; i++) dispatchInputEvent(&records[i]);
+    return count;
+}
+
+jint noncritical_submit_batch(__attribute__((unused)) JNIEnv* env, __attribute__((unused)) jclass clazz, jint count) {
+    return critical_submit_batch(count);
+}
+
 
 JNIEXPORT void JNICALL Java_org_lwjgl_glfw_GLFW_nglfwSetShowingWindow(__attribute__((unused)) JNIEnv* env, __attribute__((unused)) jclass clazz, jlong window) {
     pojav_environ->showingWindow = (long) window;
+    // From now on Android input goes to the queue of this window
+    atomic_store_explicit(&pojav_environ->showingInput, obtainWindowInput((long) window), memory_order_release);
 }
 
 JNIEXPORT void JNICALL Java_org_lwjgl_glfw_CallbackBridge_nativeSetWindowAttrib(__attribute__((unused)) JNIEnv* env, __attribute__((unused)) jclass clazz, jint attrib, jint value) {
@@ -487,18 +900,10 @@ JNIEXPORT void JNICALL Java_org_lwjgl_glfw_CallbackBridge_nativeSetWindowAttrib(
 
     // We cannot use pojav_environ->runtimeJNIEnvPtr_JRE here because that environment is attached
     // on the thread that loaded pojavexec (which is the thread that first references the GLFW class)
-    // But this method is only called from the Android UI thread
-    // Technically the better solution would be to have a permanently attached env pointer stored
-    // in environ for the Android UI thread but this is the only place that uses it
-    // (very rarely, only in lifecycle callbacks) so i dont care
-    JavaVM* jvm = pojav_environ->runtimeJavaVMPtr;
-    JNIEnv *jvm_env = NULL;
-    jint env_result = (*jvm)->GetEnv(jvm, (void**)&jvm_env, JNI_VERSION_1_4);
-    if(env_result == JNI_EDETACHED) {
-        env_result = (*jvm)->AttachCurrentThread(jvm, &jvm_env, NULL);
-    }
-    if(env_result != JNI_OK) {
-        printf("input_bridge nativeSetWindowAttrib() JNI call failed: %i\n", env_result);
+    // But this method is only called from the Android UI thread, which stays attached to the game VM
+    JNIEnv *jvm_env = jni_attach_env(pojav_environ->runtimeJavaVMPtr);
+    if(jvm_env == NULL) {
+        printf("input_bridge nativeSetWindowAttrib() JNI call failed\n");
         return;
     }
     (*jvm_env)->CallStaticVoidMethod(
@@ -506,29 +911,42 @@ JNIEXPORT void JNICALL Java_org_lwjgl_glfw_CallbackBridge_nativeSetWindowAttrib(
             pojav_environ->method_glftSetWindowAttrib,
             (jlong) pojav_environ->showingWindow, attrib, value
     );
-
-    // Attaching every time is annoying, so stick the attachment to the Android GUI thread around
 }
+
 const static JNINativeMethod critical_fcns[] = {
         {"nativeSetUseInputStackQueue", "(Z)V", critical_set_stackqueue},
+        {"nativeSetInputOverflowPolicy", "(I)V", critical_set_input_overflow_policy},
+        {"nativeSetCursorMotionMode", "(II)V", critical_set_cursor_motion_mode},
         {"nativeSendChar", "(C)Z", critical_send_char},
         {"nativeSendCharMods", "(CI)Z", critical_send_char_mods},
         {"nativeSendKey", "(IIII)V", critical_send_key},
         {"nativeSendCursorPos", "(FF)V", critical_send_cursor_pos},
+        {"nativeSendCursorDelta", "(FF)V", critical_send_cursor_delta},
         {"nativeSendMouseButton", "(III)V", critical_send_mouse_button},
         {"nativeSendScroll", "(DD)V", critical_send_scroll},
-        {"nativeSendScreenSize", "(II)V", critical_send_screen_size}
+        {"nativeSendScreenSize", "(II)V", critical_send_screen_size},
+        {"nativeSubmitBatch", "(I)I", critical_submit_batch},
+        {"nativeSendTouchEvent", "(IIIIJ)V", critical_send_touch_event},
+        {"nativeTouchTick", "(J)Z", critical_touch_tick},
+        {"nativeSetGestureConfig", "(IFFIFF)V", critical_set_gesture_config}
 };
 
 const static JNINativeMethod noncritical_fcns[] = {
         {"nativeSetUseInputStackQueue", "(Z)V", noncritical_set_stackqueue},
+        {"nativeSetInputOverflowPolicy", "(I)V", noncritical_set_input_overflow_policy},
+        {"nativeSetCursorMotionMode", "(II)V", noncritical_set_cursor_motion_mode},
         {"nativeSendChar", "(C)Z", noncritical_send_char},
         {"nativeSendCharMods", "(CI)Z", noncritical_send_char_mods},
         {"nativeSendKey", "(IIII)V", noncritical_send_key},
         {"nativeSendCursorPos", "(FF)V", noncritical_send_cursor_pos},
+        {"nativeSendCursorDelta", "(FF)V", noncritical_send_cursor_delta},
         {"nativeSendMouseButton", "(III)V", noncritical_send_mouse_button},
         {"nativeSendScroll", "(DD)V", noncritical_send_scroll},
-        {"nativeSendScreenSize", "(II)V", noncritical_send_screen_size}
+        {"nativeSendScreenSize", "(II)V", noncritical_send_screen_size},
+        {"nativeSubmitBatch", "(I)I", noncritical_submit_batch},
+        {"nativeSendTouchEvent", "(IIIIJ)V", noncritical_send_touch_event},
+        {"nativeTouchTick", "(J)Z", noncritical_touch_tick},
+        {"nativeSetGestureConfig", "(IFFIFF)V", noncritical_set_gesture_config}
 };
 
 
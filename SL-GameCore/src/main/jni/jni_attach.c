@@ -0,0 +1,82 @@
+//
+// Per-thread JNIEnv cache, see jni_attach.h
+//
+// Both the Android VM and the game VM live in this process, so a thread may be attached to each.
+// Threads that were already attached (Java threads) are cached too, but never detached by us.
+//
+
+#include <jni.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "logger/logger.h"
+#include "jni_attach.h"
+
+#define MAX_CACHED_VMS 2
+
+typedef struct {
+    JavaVM* vm;
+    JNIEnv* env;
+    bool attachedByUs;
+} vm_attachment_t;
+
+typedef struct {
+    vm_attachment_t vms[MAX_CACHED_VMS];
+} thread_attachments_t;
+
+static pthread_key_t attachmentsKey;
+static pthread_once_t attachmentsKeyOnce = PTHREAD_ONCE_INIT;
+
+/** pthread key destructor, runs when a thread that used the cache exits */
+static void detachThread(void* data) {
+    thread_attachments_t* attachments = data;
+    for (int i = 0; i < MAX_CACHED_VMS; i++) {
+        vm_attachment_t* attachment = &attachments->vms[i];
+        if (attachment->vm != NULL && attachment->attachedByUs)
+            (*attachment->vm)->DetachCurrentThread(attachment->vm);
+    }
+    free(attachments);
+}
+
+static void createAttachmentsKey() {
+    pthread_key_create(&attachmentsKey, detachThread);
+}
+
+JNIEnv* jni_attach_env(JavaVM* vm) {
+    if (vm == NULL) return NULL;
+    pthread_once(&attachmentsKeyOnce, createAttachmentsKey);
+    thread_attachments_t* attachments = pthread_getspecific(attachmentsKey);
+    if (attachments != NULL) {
+        for (int i = 0; i < MAX_CACHED_VMS; i++) {
+            if (attachments->vms[i].vm == vm) return attachments->vms[i].env;
+        }
+    }
+
+    JNIEnv* env = NULL;
+    bool attachedByUs = false;
+    jint result = (*vm)->GetEnv(vm, (void**) &env, JNI_VERSION_1_4);
+    if (result == JNI_EDETACHED) {
+        result = (*vm)->AttachCurrentThread(vm, &env, NULL);
+        attachedByUs = true;
+    }
+    if (result != JNI_OK) {
+        LOG_TO_E("<%s> %s: %i", "JNIAttach", "Failed to get a JNIEnv", result);
+        return NULL;
+    }
+
+    if (attachments == NULL) {
+        attachments = calloc(1, sizeof(thread_attachments_t));
+        if (attachments == NULL) return env;
+        pthread_setspecific(attachmentsKey, attachments);
+    }
+    for (int i = 0; i < MAX_CACHED_VMS; i++) {
+        vm_attachment_t* attachment = &attachments->vms[i];
+        if (attachment->vm != NULL) continue;
+        attachment->vm = vm;
+        attachment->env = env;
+        attachment->attachedByUs = attachedByUs;
+        break;
+    }
+    return env;
+}
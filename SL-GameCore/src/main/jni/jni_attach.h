@@ -0,0 +1,18 @@
+//
+// Per-thread JNIEnv cache for upcalls from native threads.
+// A thread is attached to a VM the first time it needs it and stays attached until it exits,
+// instead of paying for an attach (and a new java.lang.Thread) on every call.
+//
+
+#ifndef POJAVLAUNCHER_JNI_ATTACH_H
+#define POJAVLAUNCHER_JNI_ATTACH_H
+
+#include <jni.h>
+
+/**
+ * @return the JNIEnv of the calling thread for vm, attaching the thread if needed, NULL on failure.
+ * Never detach a thread obtained through this, the cache does it when the thread exits.
+ */
+JNIEnv* jni_attach_env(JavaVM* vm);
+
+#endif //POJAVLAUNCHER_JNI_ATTACH_H
@@ -7,6 +7,7 @@
 #include <jni.h>
 
 #include <environ/environ.h>
+#include "ctxbridges/gl_profiler.h"
 
 #include <dlfcn.h>
 #include <string.h>
@@ -42,6 +43,17 @@ static jlong ndlopen_bugfix(__attribute__((unused)) JNIEnv *env,
     return (jlong) dlopen(filename, mode);
 }
 
+/**
+ * LWJGL's ndlsym(), for the GL profiler to hand out its wrappers to the game as well.
+ */
+static jlong ndlsym_profiled(__attribute__((unused)) JNIEnv *env,
+                             __attribute__((unused)) jclass class,
+                             jlong handle_ptr,
+                             jlong name_ptr) {
+    const char* name = (const char*) name_ptr;
+    return (jlong) gl_profiler_wrap(name, dlsym((void*) handle_ptr, name));
+}
+
 /**
  * Install the LWJGL dlopen hook. This allows us to mitigate linker bugs and add custom library overrides.
  */
@@ -61,4 +73,12 @@ void installLwjglDlopenHook() {
         __android_log_print(ANDROID_LOG_ERROR, "LwjglLinkerHook", "Failed to register the hooked method");
         (*env)->ExceptionClear(env);
     }
+    if(!gl_profiler_enabled()) return;
+    JNINativeMethod ndlsymMethod[] = {
+            {"ndlsym", "(JJ)J", &ndlsym_profiled}
+    };
+    if((*env)->RegisterNatives(env, dynamicLinkLoader, ndlsymMethod, 1) != 0) {
+        __android_log_print(ANDROID_LOG_ERROR, "LwjglLinkerHook", "Failed to register the profiled dlsym()");
+        (*env)->ExceptionClear(env);
+    }
 }
\ No newline at end of file
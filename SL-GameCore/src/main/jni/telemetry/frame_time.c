@@ -0,0 +1,125 @@
+//
+// Frame-time telemetry, see frame_time.h
+//
+// Only the render thread writes. The histogram mirrors the ring exactly: every new frame time is
+// added and the one it overwrites is removed, so the percentiles are always over the last frames.
+//
+
+#include <jni.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "histogram.h"
+#include "upcall_dispatcher.h"
+#include "frame_time.h"
+
+/* Fields of the summary handed to ZLBridge.readFrameStats() */
+#define SUMMARY_FIELDS 7
+
+/* How often the percentiles are recomputed */
+#define SUMMARY_INTERVAL_NS 100000000LL
+#define SECOND_NS 1000000000LL
+
+static frame_stats_t stats;
+static histogram_t window;
+static int64_t lastPresent, lastSummary, secondStart;
+static uint32_t framesThisSecond;
+
+static void summarize() {
+    uint32_t max = 0;
+    uint32_t count = stats.frames < FRAME_TIME_HISTORY ? stats.frames : FRAME_TIME_HISTORY;
+    for (uint32_t i = 0; i < count; i++) {
+        if (stats.frame_us[i] > max) max = stats.frame_us[i];
+    }
+    stats.p50_us = (uint32_t) histogram_percentile(&window, 50);
+    stats.p95_us = (uint32_t) histogram_percentile(&window, 95);
+    stats.p99_us = (uint32_t) histogram_percentile(&window, 99);
+    stats.max_us = max;
+}
+
+void frame_time_on_present() {
+    int64_t now = telemetry_now_ns();
+    if (lastPresent == 0) {
+        lastPresent = lastSummary = secondStart = now;
+        return;
+    }
+    uint32_t frameTime = (uint32_t) ((now - lastPresent) / 1000);
+    lastPresent = now;
+
+    atomic_fetch_add_explicit(&stats.sequence, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    if (stats.frames >= FRAME_TIME_HISTORY) {
+        histogram_remove(&window, stats.frame_us[stats.head]);
+    }
+    histogram_record(&window, frameTime);
+    stats.frame_us[stats.head] = frameTime;
+    stats.head = (stats.head + 1) % FRAME_TIME_HISTORY;
+    stats.frames++;
+    // The median is only refreshed with the summary, which is plenty to tell a hitch apart
+    if (stats.p50_us != 0 && frameTime > 2 * stats.p50_us) stats.hitches++;
+
+    if (now - lastSummary >= SUMMARY_INTERVAL_NS) {
+        lastSummary = now;
+        summarize();
+    }
+
+    framesThisSecond++;
+    bool secondPassed = now - secondStart >= SECOND_NS;
+    if (secondPassed) {
+        stats.fps = framesThisSecond;
+        framesThisSecond = 0;
+        secondStart = now;
+    }
+
+    atomic_store_explicit(&stats.sequence, atomic_load_explicit(&stats.sequence, memory_order_relaxed) + 1, memory_order_release);
+
+    // Keeps ZLBridgeStates.currentFPS going for the existing overlay
+    if (secondPassed) upcall_post(UPCALL_FPS, (int) stats.fps, NULL);
+}
+
+/**
+ * @return a direct buffer over the live frame statistics, see frame_stats_t for its layout
+ */
+JNIEXPORT jobject JNICALL
+Java_com_lanrhyme_shardlauncher_bridge_ZLBridge_getFrameStatsBuffer(JNIEnv *env, __attribute__((unused)) jclass clazz) {
+    return (*env)->NewDirectByteBuffer(env, &stats, sizeof(stats));
+}
+
+/**
+ * Copy a consistent snapshot of the frame statistics, retrying while the render thread is updating them.
+ * @param summary receives { frames, fps, p50, p95, p99, max, hitches }
+ * @param frameTimes if not null, receives the latest frame times, newest first
+ * @return how many frame times were copied
+ */
+JNIEXPORT jint JNICALL
+Java_com_lanrhyme_shardlauncher_bridge_ZLBridge_readFrameStats(JNIEnv *env, __attribute__((unused)) jclass clazz, jintArray summary, jintArray frameTimes) {
+    frame_stats_t snapshot;
+    unsigned int sequence;
+    do {
+        sequence = atomic_load_explicit(&stats.sequence, memory_order_acquire);
+        memcpy(&snapshot, &stats, sizeof(stats));
+        // Keeps the copy from being read after the sequence below
+        atomic_thread_fence(memory_order_acquire);
+    } while ((sequence & 1) != 0 || sequence != atomic_load_explicit(&stats.sequence, memory_order_relaxed));
+
+    jint fields[SUMMARY_FIELDS] = {
+            (jint) snapshot.frames, (jint) snapshot.fps, (jint) snapshot.p50_us, (jint) snapshot.p95_us,
+            (jint) snapshot.p99_us, (jint) snapshot.max_us, (jint) snapshot.hitches
+    };
+    if (summary != NULL) {
+        jsize length = (*env)->GetArrayLength(env, summary);
+        (*env)->SetIntArrayRegion(env, summary, 0, length < SUMMARY_FIELDS ? length : SUMMARY_FIELDS, fields);
+    }
+    if (frameTimes == NULL) return 0;
+
+    jint newestFirst[FRAME_TIME_HISTORY];
+    jsize copied = (*env)->GetArrayLength(env, frameTimes);
+    if ((uint32_t) copied > snapshot.frames) copied = (jsize) snapshot.frames;
+    if (copied > FRAME_TIME_HISTORY) copied = FRAME_TIME_HISTORY;
+    for (jsize i = 0; i < copied; i++) {
+        newestFirst[i] = (jint) snapshot.frame_us[(snapshot.head + FRAME_TIME_HISTORY - 1 - i) % FRAME_TIME_HISTORY];
+    }
+    (*env)->SetIntArrayRegion(env, frameTimes, 0, copied, newestFirst);
+    return copied;
+}
@@ -0,0 +1,31 @@
+//
+// Frame-time telemetry.
+// pojavSwapBuffers() reports every presented frame, the intervals between them are kept in a ring
+// together with rolling percentiles and a hitch counter. The launcher copies them out with
+// ZLBridge.readFrameStats(), the raw block is also exposed as a direct ByteBuffer.
+//
+
+#ifndef POJAVLAUNCHER_FRAME_TIME_H
+#define POJAVLAUNCHER_FRAME_TIME_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+/* Frames kept in the ring, the percentiles cover all of them */
+#define FRAME_TIME_HISTORY 512
+
+/* Layout shared with ZLBridge.FRAME_STATS_*, all fields are native-endian 32-bit integers */
+typedef struct {
+    atomic_uint sequence; // Odd while the fields below are being updated, read them again if it changed meanwhile
+    uint32_t frames; // Presented since the start
+    uint32_t head; // Next slot of frame_us to be written, the newest frame time is just before it
+    uint32_t fps; // Frames presented during the last full second
+    uint32_t p50_us, p95_us, p99_us, max_us; // Over the frames in the ring
+    uint32_t hitches; // Frames that took more than twice the rolling median, since the start
+    uint32_t frame_us[FRAME_TIME_HISTORY];
+} frame_stats_t;
+
+/* Called by pojavSwapBuffers() once the frame has been submitted */
+void frame_time_on_present();
+
+#endif //POJAVLAUNCHER_FRAME_TIME_H
@@ -0,0 +1,70 @@
+//
+// Log-linear histogram shared by the bridge telemetry.
+// Values are bucketed with 8 sub-buckets per power of two, so any recorded value
+// is reported within 12.5% of itself, while the whole range fits in 256 counters.
+//
+
+#ifndef POJAVLAUNCHER_HISTOGRAM_H
+#define POJAVLAUNCHER_HISTOGRAM_H
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#define HISTOGRAM_BUCKETS 256
+
+typedef struct {
+    uint32_t buckets[HISTOGRAM_BUCKETS];
+    uint64_t count;
+    uint64_t max;
+} histogram_t;
+
+static inline int64_t telemetry_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static inline unsigned histogram_bucket_of(uint64_t value) {
+    if (value < 8) return (unsigned) value;
+    unsigned exponent = 63 - __builtin_clzll(value);
+    unsigned bucket = 8 * (exponent - 2) + (unsigned) ((value >> (exponent - 3)) - 8);
+    return bucket < HISTOGRAM_BUCKETS ? bucket : HISTOGRAM_BUCKETS - 1;
+}
+
+static inline uint64_t histogram_bucket_floor(unsigned bucket) {
+    if (bucket < 8) return bucket;
+    unsigned exponent = bucket / 8 + 2;
+    return (uint64_t) (8 + bucket % 8) << (exponent - 3);
+}
+
+static inline void histogram_reset(histogram_t* histogram) {
+    memset(histogram, 0, sizeof(histogram_t));
+}
+
+static inline void histogram_record(histogram_t* histogram, uint64_t value) {
+    histogram->buckets[histogram_bucket_of(value)]++;
+    histogram->count++;
+    if (value > histogram->max) histogram->max = value;
+}
+
+/** Take back a value recorded before, for rolling windows. The max is left alone */
+static inline void histogram_remove(histogram_t* histogram, uint64_t value) {
+    histogram->buckets[histogram_bucket_of(value)]--;
+    histogram->count--;
+}
+
+/** @return the lower bound of the bucket holding the given percentile (0-100), 0 if nothing was recorded */
+static inline uint64_t histogram_percentile(const histogram_t* histogram, unsigned percentile) {
+    if (histogram->count == 0) return 0;
+    uint64_t rank = (histogram->count * percentile + 99) / 100;
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (unsigned bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++) {
+        seen += histogram->buckets[bucket];
+        if (seen >= rank) return histogram_bucket_floor(bucket);
+    }
+    return histogram->max;
+}
+
+#endif //POJAVLAUNCHER_HISTOGRAM_H
@@ -0,0 +1,107 @@
+//
+// Input-to-present latency tracing, see input_latency.h
+//
+// Pumping and swapping both happen on the game thread, so the recording side needs no locking.
+// Readers (the launcher overlay, the trace writer) may see counters that are one frame old.
+//
+
+#include <jni.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "logger/logger.h"
+#include "histogram.h"
+#include "input_latency.h"
+
+/* Delivered events waiting for the next swap. The rest of a very busy frame is only counted in the queue histogram */
+#define MAX_PENDING_PRESENT 256
+/* How often the trace file gets a new line */
+#define TRACE_INTERVAL_NS 1000000000LL
+
+static histogram_t queueLatency;
+static histogram_t presentLatency;
+static int64_t pendingPresent[MAX_PENDING_PRESENT];
+static int pendingPresentCount;
+
+static FILE* traceFile;
+static bool traceFileChecked;
+static int64_t lastTraceTime;
+
+void input_latency_on_delivered(int64_t enqueue_time_ns) {
+    int64_t now = telemetry_now_ns();
+    histogram_record(&queueLatency, (uint64_t) (now - enqueue_time_ns) / 1000);
+    if (pendingPresentCount < MAX_PENDING_PRESENT)
+        pendingPresent[pendingPresentCount++] = enqueue_time_ns;
+}
+
+static void summarize(const histogram_t* histogram, latency_summary_t* summary) {
+    summary->count = histogram->count;
+    summary->p50_us = histogram_percentile(histogram, 50);
+    summary->p95_us = histogram_percentile(histogram, 95);
+    summary->p99_us = histogram_percentile(histogram, 99);
+    summary->max_us = histogram->max;
+}
+
+void input_latency_get(latency_summary_t* queue, latency_summary_t* present) {
+    if (queue) summarize(&queueLatency, queue);
+    if (present) summarize(&presentLatency, present);
+}
+
+void input_latency_reset() {
+    histogram_reset(&queueLatency);
+    histogram_reset(&presentLatency);
+    pendingPresentCount = 0;
+}
+
+static void write_trace(int64_t now) {
+    if (!traceFileChecked) {
+        traceFileChecked = true;
+        const char* tracePath = getenv("POJAV_INPUT_LATENCY_TRACE");
+        if (tracePath == NULL) return;
+        traceFile = fopen(tracePath, "w");
+        if (traceFile == NULL) {
+            LOG_TO_E("<%s> %s: %s", "InputLatency", "Failed to open the trace file", tracePath);
+            return;
+        }
+        const char* renderer = getenv("POJAV_RENDERER");
+        fprintf(traceFile, "# renderer=%s\n", renderer ? renderer : "unknown");
+        fprintf(traceFile, "time_ms,presented_events,queue_p50_us,queue_p95_us,queue_p99_us,present_p50_us,present_p95_us,present_p99_us,present_max_us\n");
+    }
+    if (traceFile == NULL || now - lastTraceTime < TRACE_INTERVAL_NS) return;
+    lastTraceTime = now;
+
+    latency_summary_t queue, present;
+    input_latency_get(&queue, &present);
+    fprintf(traceFile, "%lld,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu\n",
+            (long long) (now / 1000000), (unsigned long long) present.count,
+            (unsigned long long) queue.p50_us, (unsigned long long) queue.p95_us, (unsigned long long) queue.p99_us,
+            (unsigned long long) present.p50_us, (unsigned long long) present.p95_us, (unsigned long long) present.p99_us,
+            (unsigned long long) present.max_us);
+    fflush(traceFile);
+}
+
+void input_latency_on_present() {
+    int64_t now = telemetry_now_ns();
+    for (int i = 0; i < pendingPresentCount; i++)
+        histogram_record(&presentLatency, (uint64_t) (now - pendingPresent[i]) / 1000);
+    pendingPresentCount = 0;
+    write_trace(now);
+}
+
+/**
+ * @return { queue count, p50, p95, p99, max, present count, p50, p95, p99, max }, latencies in microseconds
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_lanrhyme_shardlauncher_bridge_ZLBridge_getInputLatencyStats(JNIEnv *env, __attribute__((unused)) jclass clazz) {
+    latency_summary_t queue, present;
+    input_latency_get(&queue, &present);
+    jlong values[] = {
+            (jlong) queue.count, (jlong) queue.p50_us, (jlong) queue.p95_us, (jlong) queue.p99_us, (jlong) queue.max_us,
+            (jlong) present.count, (jlong) present.p50_us, (jlong) present.p95_us, (jlong) present.p99_us, (jlong) present.max_us
+    };
+    jlongArray result = (*env)->NewLongArray(env, sizeof(values) / sizeof(values[0]));
+    if (result == NULL) return NULL;
+    (*env)->SetLongArrayRegion(env, result, 0, sizeof(values) / sizeof(values[0]), values);
+    return result;
+}
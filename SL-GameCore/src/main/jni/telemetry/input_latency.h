@@ -0,0 +1,26 @@
+//
+// Input-to-present latency tracing.
+// Events are stamped when queued by sendData(), the pump records when they reach the game
+// and the first swap afterwards records when they could have been seen on screen.
+//
+
+#ifndef POJAVLAUNCHER_INPUT_LATENCY_H
+#define POJAVLAUNCHER_INPUT_LATENCY_H
+
+#include <stdint.h>
+
+typedef struct {
+    uint64_t count;
+    uint64_t p50_us, p95_us, p99_us, max_us;
+} latency_summary_t;
+
+/* Called by pojavPumpEvents() for every event it hands to the game */
+void input_latency_on_delivered(int64_t enqueue_time_ns);
+/* Called by pojavSwapBuffers() once the frame has been submitted */
+void input_latency_on_present();
+
+void input_latency_get(latency_summary_t* queue, latency_summary_t* present);
+/* Forget everything recorded so far, must be called from the game thread or while no game runs */
+void input_latency_reset();
+
+#endif //POJAVLAUNCHER_INPUT_LATENCY_H
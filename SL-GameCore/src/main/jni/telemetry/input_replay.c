@@ -0,0 +1,257 @@
+//
+// Deterministic input record/replay, see input_replay.h
+//
+// The file is a small header followed by fixed size records, each one holding the event
+// and its time relative to the start of the recording. Native byte order, it is only meant
+// to be replayed on the device family that recorded it.
+//
+// While replaying, the replay thread is the only producer of the input queues:
+// events coming from the Android UI are dropped by input_replay_admit().
+//
+
+#include <jni.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "logger/logger.h"
+#include "histogram.h"
+#include "input_replay.h"
+
+#define INPUT_REPLAY_MAGIC "PJIR"
+#define INPUT_REPLAY_VERSION 1
+/* Longest uninterrupted sleep of the replay thread, bounds how long stopping a replay takes */
+#define REPLAY_WAIT_SLICE_NS 50000000LL
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t reserved;
+} replay_file_header_t;
+
+typedef struct {
+    int64_t time; // Nanoseconds since the start of the recording
+    input_replay_event_t event;
+    int32_t reserved;
+} replay_file_record_t;
+_Static_assert(sizeof(replay_file_record_t) == 32, "Replay records must stay 32 bytes");
+
+atomic_int input_replay_mode;
+
+static pthread_mutex_t replayLock = PTHREAD_MUTEX_INITIALIZER;
+static input_replay_dispatch_func* dispatcher;
+static _Thread_local bool isReplayThread;
+
+static FILE* recordFile;
+static char recordFileBuffer[64 * 1024];
+static int64_t recordStartTime;
+static uint64_t recordedEvents;
+
+static pthread_t replayThread;
+static bool hasReplayThread;
+static bool replayLoop;
+static atomic_bool replayStopRequested;
+
+bool input_replay_admit_slow(const input_replay_event_t* event) {
+    int mode = atomic_load_explicit(&input_replay_mode, memory_order_relaxed);
+    if (mode == INPUT_REPLAY_REPLAYING) return isReplayThread;
+    if (mode != INPUT_REPLAY_RECORDING) return true;
+
+    // Fully buffered, so this only reaches the disk once every couple thousand events
+    pthread_mutex_lock(&replayLock);
+    if (recordFile != NULL) {
+        replay_file_record_t record = {
+                .time = telemetry_now_ns() - recordStartTime,
+                .event = *event
+        };
+        if (fwrite(&record, sizeof(record), 1, recordFile) == 1) recordedEvents++;
+    }
+    pthread_mutex_unlock(&replayLock);
+    return true;
+}
+
+void input_replay_set_dispatcher(input_replay_dispatch_func* dispatch) {
+    dispatcher = dispatch;
+}
+
+bool input_replay_start_recording(const char* path) {
+    pthread_mutex_lock(&replayLock);
+    if (atomic_load_explicit(&input_replay_mode, memory_order_relaxed) != INPUT_REPLAY_IDLE) {
+        pthread_mutex_unlock(&replayLock);
+        LOG_TO_W("<%s> %s", "InputReplay", "Can't record while already recording or replaying");
+        return false;
+    }
+    recordFile = fopen(path, "wb");
+    if (recordFile == NULL) {
+        pthread_mutex_unlock(&replayLock);
+        LOG_TO_E("<%s> %s: %s", "InputReplay", "Failed to create the recording", path);
+        return false;
+    }
+    setvbuf(recordFile, recordFileBuffer, _IOFBF, sizeof(recordFileBuffer));
+
+    replay_file_header_t header = {
+            .magic = INPUT_REPLAY_MAGIC,
+            .version = INPUT_REPLAY_VERSION,
+            .recordSize = sizeof(replay_file_record_t)
+    };
+    fwrite(&header, sizeof(header), 1, recordFile);
+    recordStartTime = telemetry_now_ns();
+    recordedEvents = 0;
+    atomic_store_explicit(&input_replay_mode, INPUT_REPLAY_RECORDING, memory_order_relaxed);
+    pthread_mutex_unlock(&replayLock);
+
+    LOG_TO_I("<%s> %s: %s", "InputReplay", "Recording input to", path);
+    return true;
+}
+
+void input_replay_stop_recording() {
+    pthread_mutex_lock(&replayLock);
+    if (recordFile != NULL) {
+        atomic_store_explicit(&input_replay_mode, INPUT_REPLAY_IDLE, memory_order_relaxed);
+        fclose(recordFile);
+        recordFile = NULL;
+        LOG_TO_I("<%s> %s: %llu", "InputReplay", "Recorded events", (unsigned long long) recordedEvents);
+    }
+    pthread_mutex_unlock(&replayLock);
+}
+
+/** Sleep until the given CLOCK_MONOTONIC time, @return false if the replay got stopped meanwhile */
+static bool waitUntil(int64_t target) {
+    while (!atomic_load_explicit(&replayStopRequested, memory_order_relaxed)) {
+        int64_t now = telemetry_now_ns();
+        if (now >= target) return true;
+        int64_t wakeup = target - now > REPLAY_WAIT_SLICE_NS ? now + REPLAY_WAIT_SLICE_NS : target;
+        struct timespec ts = { .tv_sec = wakeup / 1000000000LL, .tv_nsec = wakeup % 1000000000LL };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+    return false;
+}
+
+static void* replayThreadMain(void* arg) {
+    FILE* file = arg;
+    isReplayThread = true;
+
+    uint64_t replayed = 0, replayedThisPass = 0;
+    int64_t startTime = telemetry_now_ns();
+    replay_file_record_t record;
+    while (!atomic_load_explicit(&replayStopRequested, memory_order_relaxed)) {
+        if (fread(&record, sizeof(record), 1, file) != 1) {
+            if (!replayLoop || replayedThisPass == 0) break;
+            fseek(file, sizeof(replay_file_header_t), SEEK_SET);
+            startTime = telemetry_now_ns();
+            replayedThisPass = 0;
+            continue;
+        }
+        if (!waitUntil(startTime + record.time)) break;
+        dispatcher(&record.event);
+        replayed++;
+        replayedThisPass++;
+    }
+    fclose(file);
+
+    // Hand the input back to Android, unless someone already did
+    int expected = INPUT_REPLAY_REPLAYING;
+    atomic_compare_exchange_strong(&input_replay_mode, &expected, INPUT_REPLAY_IDLE);
+    LOG_TO_I("<%s> %s: %llu", "InputReplay", "Replay finished, replayed events", (unsigned long long) replayed);
+    return NULL;
+}
+
+bool input_replay_start(const char* path, bool loop) {
+    if (dispatcher == NULL) {
+        LOG_TO_E("<%s> %s", "InputReplay", "No dispatcher, the input bridge is not loaded");
+        return false;
+    }
+    pthread_mutex_lock(&replayLock);
+    if (atomic_load_explicit(&input_replay_mode, memory_order_relaxed) != INPUT_REPLAY_IDLE) {
+        pthread_mutex_unlock(&replayLock);
+        LOG_TO_W("<%s> %s", "InputReplay", "Can't replay while already recording or replaying");
+        return false;
+    }
+    // The previous replay thread has finished since the mode went back to idle, reap it
+    if (hasReplayThread) {
+        pthread_join(replayThread, NULL);
+        hasReplayThread = false;
+    }
+
+    FILE* file = fopen(path, "rb");
+    replay_file_header_t header;
+    if (file == NULL || fread(&header, sizeof(header), 1, file) != 1
+        || memcmp(header.magic, INPUT_REPLAY_MAGIC, sizeof(header.magic)) != 0
+        || header.version != INPUT_REPLAY_VERSION || header.recordSize != sizeof(replay_file_record_t)) {
+        if (file != NULL) fclose(file);
+        pthread_mutex_unlock(&replayLock);
+        LOG_TO_E("<%s> %s: %s", "InputReplay", "Not a usable input recording", path);
+        return false;
+    }
+
+    replayLoop = loop;
+    atomic_store_explicit(&replayStopRequested, false, memory_order_relaxed);
+    atomic_store_explicit(&input_replay_mode, INPUT_REPLAY_REPLAYING, memory_order_relaxed);
+    if (pthread_create(&replayThread, NULL, replayThreadMain, file) != 0) {
+        atomic_store_explicit(&input_replay_mode, INPUT_REPLAY_IDLE, memory_order_relaxed);
+        fclose(file);
+        pthread_mutex_unlock(&replayLock);
+        LOG_TO_E("<%s> %s", "InputReplay", "Failed to start the replay thread");
+        return false;
+    }
+    pthread_setname_np(replayThread, "InputReplay");
+    hasReplayThread = true;
+    pthread_mutex_unlock(&replayLock);
+
+    LOG_TO_I("<%s> %s: %s", "InputReplay", "Replaying input from", path);
+    return true;
+}
+
+void input_replay_stop() {
+    pthread_mutex_lock(&replayLock);
+    if (hasReplayThread) {
+        atomic_store_explicit(&replayStopRequested, true, memory_order_relaxed);
+        pthread_join(replayThread, NULL);
+        hasReplayThread = false;
+    }
+    pthread_mutex_unlock(&replayLock);
+}
+
+void input_replay_start_from_env() {
+    static bool envChecked;
+    if (envChecked) return;
+    envChecked = true;
+
+    const char* replayPath = getenv("POJAV_INPUT_REPLAY");
+    if (replayPath != NULL) {
+        const char* loop = getenv("POJAV_INPUT_REPLAY_LOOP");
+        input_replay_start(replayPath, loop != NULL && strcmp(loop, "1") == 0);
+        return;
+    }
+    const char* recordPath = getenv("POJAV_INPUT_RECORD");
+    if (recordPath != NULL) input_replay_start_recording(recordPath);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_lanrhyme_shardlauncher_bridge_ZLBridge_startInputRecording(JNIEnv *env, __attribute__((unused)) jclass clazz, jstring path) {
+    const char* pathC = (*env)->GetStringUTFChars(env, path, NULL);
+    bool started = input_replay_start_recording(pathC);
+    (*env)->ReleaseStringUTFChars(env, path, pathC);
+    return started;
+}
+
+JNIEXPORT void JNICALL
+Java_com_lanrhyme_shardlauncher_bridge_ZLBridge_stopInputRecording(__attribute__((unused)) JNIEnv *env, __attribute__((unused)) jclass clazz) {
+    input_replay_stop_recording();
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_lanrhyme_shardlauncher_bridge_ZLBridge_startInputReplay(JNIEnv *env, __attribute__((unused)) jclass clazz, jstring path, jboolean loop) {
+    const char* pathC = (*env)->GetStringUTFChars(env, path, NULL);
+    bool started = input_replay_start(pathC, loop);
+    (*env)->ReleaseStringUTFChars(env, path, pathC);
+    return started;
+}
+
+JNIEXPORT void JNICALL
+Java_com_lanrhyme_shardlauncher_bridge_ZLBridge_stopInputReplay(__attribute__((unused)) JNIEnv *env, __attribute__((unused)) jclass clazz) {
+    input_replay_stop();
+}
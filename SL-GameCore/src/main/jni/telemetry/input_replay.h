@@ -0,0 +1,53 @@
+//
+// Deterministic input record/replay, used to benchmark the renderers and the bridge with
+// the exact same gameplay session on every build.
+// Recording logs every event that enters the send paths of input_bridge_v3.c, with its time,
+// replaying feeds them back through the same paths from a timer thread instead of the Android UI.
+//
+
+#ifndef POJAVLAUNCHER_INPUT_REPLAY_H
+#define POJAVLAUNCHER_INPUT_REPLAY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#define INPUT_REPLAY_IDLE 0
+#define INPUT_REPLAY_RECORDING 1
+#define INPUT_REPLAY_REPLAYING 2
+
+/* One input event, the arguments are floats for cursor positions and scrolling and ints otherwise */
+typedef struct {
+    int32_t type;
+    union {
+        int32_t i;
+        float f;
+    } args[4];
+} input_replay_event_t;
+
+/* Feeds a replayed event into the bridge, called from the replay thread */
+typedef void input_replay_dispatch_func(const input_replay_event_t* event);
+
+extern atomic_int input_replay_mode;
+
+bool input_replay_admit_slow(const input_replay_event_t* event);
+
+/**
+ * Called by the bridge for every event before sending it.
+ * @return false if the event must be dropped, because a replay currently owns the input
+ */
+static inline bool input_replay_admit(const input_replay_event_t* event) {
+    if (atomic_load_explicit(&input_replay_mode, memory_order_relaxed) == INPUT_REPLAY_IDLE) return true;
+    return input_replay_admit_slow(event);
+}
+
+void input_replay_set_dispatcher(input_replay_dispatch_func* dispatch);
+/* Start what POJAV_INPUT_RECORD or POJAV_INPUT_REPLAY ask for, once the game accepts input */
+void input_replay_start_from_env();
+
+bool input_replay_start_recording(const char* path);
+void input_replay_stop_recording();
+bool input_replay_start(const char* path, bool loop);
+void input_replay_stop();
+
+#endif //POJAVLAUNCHER_INPUT_REPLAY_H
@@ -0,0 +1,36 @@
+//
+// Surface swap latency, see surface_swap.h
+//
+// Only the render thread records. Window changes are rare, so every one of them is logged too.
+//
+
+#include <jni.h>
+
+#include "logger/logger.h"
+#include "histogram.h"
+#include "surface_swap.h"
+
+static histogram_t fullSwaps;
+static histogram_t resizes;
+
+void surface_swap_record(int64_t duration_ns, bool resized) {
+    uint64_t duration_us = (uint64_t) duration_ns / 1000;
+    histogram_record(resized ? &resizes : &fullSwaps, duration_us);
+    LOG_TO_I("<%s> %s: %llu us", "SurfaceSwap", resized ? "Resized the window surface in place" : "Recreated the window surface",
+             (unsigned long long) duration_us);
+}
+
+/**
+ * @return { full swap count, p50, p95, max, in place resize count, p50, p95, max }, durations in microseconds
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_lanrhyme_shardlauncher_bridge_ZLBridge_getSurfaceSwapStats(JNIEnv *env, __attribute__((unused)) jclass clazz) {
+    jlong values[] = {
+            (jlong) fullSwaps.count, (jlong) histogram_percentile(&fullSwaps, 50), (jlong) histogram_percentile(&fullSwaps, 95), (jlong) fullSwaps.max,
+            (jlong) resizes.count, (jlong) histogram_percentile(&resizes, 50), (jlong) histogram_percentile(&resizes, 95), (jlong) resizes.max
+    };
+    jlongArray result = (*env)->NewLongArray(env, sizeof(values) / sizeof(values[0]));
+    if (result == NULL) return NULL;
+    (*env)->SetLongArrayRegion(env, result, 0, sizeof(values) / sizeof(values[0]), values);
+    return result;
+}
@@ -0,0 +1,16 @@
+//
+// Surface swap latency: how long the renderer bridges stall a frame to take a window change.
+// Full swaps tear the window surface down and create it again, resizes keep it and only
+// change the geometry of its buffers.
+//
+
+#ifndef POJAVLAUNCHER_SURFACE_SWAP_H
+#define POJAVLAUNCHER_SURFACE_SWAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Called by the bridges on the render thread once a window change has been taken */
+void surface_swap_record(int64_t duration_ns, bool resized);
+
+#endif //POJAVLAUNCHER_SURFACE_SWAP_H
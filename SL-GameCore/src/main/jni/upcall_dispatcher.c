@@ -0,0 +1,141 @@
+//
+// Asynchronous upcalls to the Android side, see upcall_dispatcher.h
+//
+// Bounded multi-producer/single-consumer queue: every slot carries a sequence number telling whether
+// it is free for the producer at a given position or ready for the consumer, so producers only
+// contend on the enqueue position. The consumer sleeps on a semaphore that producers post.
+//
+
+#include <jni.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "logger/logger.h"
+#include "environ/environ.h"
+#include "jni_attach.h"
+#include "upcall_dispatcher.h"
+
+/* Must be a power of two */
+#define UPCALL_QUEUE_SIZE 256
+
+typedef struct {
+    int type;
+    int value;
+    char* text;
+} upcall_t;
+
+typedef struct {
+    atomic_size_t sequence;
+    upcall_t upcall;
+} upcall_slot_t;
+
+static struct {
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t enqueuePosition;
+    _Alignas(CACHE_LINE_SIZE) size_t dequeuePosition; // Only touched by the upcall thread
+    _Alignas(CACHE_LINE_SIZE) upcall_slot_t slots[UPCALL_QUEUE_SIZE];
+} queue;
+
+static sem_t queueSignal;
+static pthread_once_t dispatcherOnce = PTHREAD_ONCE_INIT;
+static bool dispatcherRunning;
+
+static bool dequeue(upcall_t* upcall) {
+    upcall_slot_t* slot = &queue.slots[queue.dequeuePosition & (UPCALL_QUEUE_SIZE - 1)];
+    if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != queue.dequeuePosition + 1) return false;
+    *upcall = slot->upcall;
+    // Hand the slot back to the producers for the next lap
+    atomic_store_explicit(&slot->sequence, queue.dequeuePosition + UPCALL_QUEUE_SIZE, memory_order_release);
+    queue.dequeuePosition++;
+    return true;
+}
+
+static void dispatch(JNIEnv* env, const upcall_t* upcall) {
+    switch (upcall->type) {
+        case UPCALL_FPS:
+            if (pojav_environ->class_ZLInvoker && pojav_environ->method_PutFpsValue)
+                (*env)->CallStaticVoidMethod(env, pojav_environ->class_ZLInvoker, pojav_environ->method_PutFpsValue, (jint) upcall->value);
+            break;
+        case UPCALL_GRAB_STATE:
+            (*env)->CallStaticVoidMethod(env, pojav_environ->bridgeClazz, pojav_environ->method_onGrabStateChanged, (jboolean) upcall->value);
+            break;
+        case UPCALL_CURSOR_SHAPE:
+            (*env)->CallStaticVoidMethod(env, pojav_environ->bridgeClazz, pojav_environ->method_onCursorShapeChanged, (jint) upcall->value);
+            break;
+        case UPCALL_CLIPBOARD: {
+            jstring text = upcall->text != NULL ? (*env)->NewStringUTF(env, upcall->text) : NULL;
+            jobject result = (*env)->CallStaticObjectMethod(env, pojav_environ->bridgeClazz, pojav_environ->method_accessAndroidClipboard, (jint) upcall->value, text);
+            if (result != NULL) (*env)->DeleteLocalRef(env, result);
+            if (text != NULL) (*env)->DeleteLocalRef(env, text);
+        } break;
+    }
+    // This thread never returns to Java, so nothing would ever clear a pending exception for us
+    if ((*env)->ExceptionCheck(env)) {
+        LOG_TO_E("<%s> %s: %i", "Upcall", "Upcall threw an exception", upcall->type);
+        (*env)->ExceptionClear(env);
+    }
+}
+
+static void* upcallThreadMain(__attribute__((unused)) void* arg) {
+    JNIEnv* env = jni_attach_env(pojav_environ->dalvikJavaVMPtr);
+    upcall_t upcall;
+    while (true) {
+        sem_wait(&queueSignal);
+        while (dequeue(&upcall)) {
+            if (env != NULL) dispatch(env, &upcall);
+            free(upcall.text);
+        }
+    }
+    return NULL;
+}
+
+static void startDispatcher() {
+    for (size_t i = 0; i < UPCALL_QUEUE_SIZE; i++)
+        atomic_init(&queue.slots[i].sequence, i);
+    sem_init(&queueSignal, 0, 0);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, upcallThreadMain, NULL) != 0) {
+        LOG_TO_E("<%s> %s", "Upcall", "Failed to start the upcall thread");
+        return;
+    }
+    pthread_setname_np(thread, "Upcalls");
+    pthread_detach(thread);
+    dispatcherRunning = true;
+}
+
+bool upcall_post(int type, int value, char* text) {
+    pthread_once(&dispatcherOnce, startDispatcher);
+    if (!dispatcherRunning || pojav_environ->dalvikJavaVMPtr == NULL) {
+        free(text);
+        return false;
+    }
+
+    size_t position = atomic_load_explicit(&queue.enqueuePosition, memory_order_relaxed);
+    upcall_slot_t* slot;
+    while (true) {
+        slot = &queue.slots[position & (UPCALL_QUEUE_SIZE - 1)];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t lag = (intptr_t) sequence - (intptr_t) position;
+        if (lag == 0) {
+            // The slot is free for this position, try to claim the position
+            if (atomic_compare_exchange_weak_explicit(&queue.enqueuePosition, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (lag < 0) {
+            // The consumer has not freed this slot since the last lap, the queue is full
+            LOG_TO_W("<%s> %s: %i", "Upcall", "Upcall queue full, dropping", type);
+            free(text);
+            return false;
+        } else {
+            position = atomic_load_explicit(&queue.enqueuePosition, memory_order_relaxed);
+        }
+    }
+
+    slot->upcall = (upcall_t) { .type = type, .value = value, .text = text };
+    atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+    sem_post(&queueSignal);
+    return true;
+}
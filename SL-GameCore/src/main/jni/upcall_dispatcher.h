@@ -0,0 +1,23 @@
+//
+// Asynchronous upcalls to the Android side.
+// Game and render threads only queue a small command, a dedicated thread makes the Dalvik JNI calls,
+// so none of them ever waits for the Android VM or the UI.
+//
+
+#ifndef POJAVLAUNCHER_UPCALL_DISPATCHER_H
+#define POJAVLAUNCHER_UPCALL_DISPATCHER_H
+
+#include <stdbool.h>
+
+#define UPCALL_FPS 0 // value: frames of the last second
+#define UPCALL_GRAB_STATE 1 // value: whether the cursor is grabbed
+#define UPCALL_CURSOR_SHAPE 2 // value: GLFW cursor shape
+#define UPCALL_CLIPBOARD 3 // value: CLIPBOARD_COPY or CLIPBOARD_OPEN, text: what to copy or open
+
+/**
+ * Queue an upcall, safe to call from any number of threads. Takes ownership of text (malloc'd, may be NULL).
+ * @return false if the queue is full and the upcall was dropped
+ */
+bool upcall_post(int type, int value, char* text);
+
+#endif //POJAVLAUNCHER_UPCALL_DISPATCHER_H
@@ -14,4 +14,8 @@ jstring convertStringJVM(JNIEnv* srcEnv, JNIEnv* dstEnv, jstring srcStr);
 void hookExec();
 void installLwjglDlopenHook();
 void installEMUIIteratorMititgation();
+void critical_send_cursor_pos(jfloat x, jfloat y);
+void critical_send_cursor_delta(jfloat dx, jfloat dy);
+void critical_send_mouse_button(jint button, jint action, jint mods);
+void critical_send_scroll(jdouble xoffset, jdouble yoffset);
 JNIEXPORT jstring JNICALL Java_org_lwjgl_glfw_CallbackBridge_nativeClipboard(JNIEnv* env, jclass clazz, jint action, jbyteArray copySrc);
\ No newline at end of file
@@ -7,7 +7,11 @@ import android.content.ClipData;
 import android.content.ClipDescription;
 import android.content.ClipboardManager;
 import android.content.Context;
+import android.os.Handler;
+import android.os.Looper;
+import android.os.SystemClock;
 import android.view.Choreographer;
+import android.view.MotionEvent;
 
 import androidx.annotation.Keep;
 import androidx.annotation.Nullable;
@@ -17,6 +21,8 @@ import com.lanrhyme.shardlauncher.bridge.ZLBridgeStates;
 import com.lanrhyme.shardlauncher.bridge.ZLNativeInvoker;
 import com.lanrhyme.shardlauncher.game.keycodes.LwjglGlfwKeycode;
 
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 import java.util.function.Consumer;
 
 import dalvik.annotation.optimization.CriticalNative;
@@ -48,6 +54,57 @@ public class CallbackBridge {
     public static final int CLIPBOARD_PASTE = 2001;
     public static final int CLIPBOARD_OPEN = 2002;
 
+    /** Input queue overflow: refuse scroll/motion early so key and button edges always fit */
+    public static final int INPUT_OVERFLOW_DROP_MOTION = 0;
+    /** Input queue overflow: refuse whatever arrives while the queue is full */
+    public static final int INPUT_OVERFLOW_DROP_NEWEST = 1;
+
+    /** Cursor motion: every sample goes straight to the game (or the latest one in stack queue mode) */
+    public static final int CURSOR_MOTION_DIRECT = 0;
+    /** Cursor motion: only the latest position is sent, once per frame */
+    public static final int CURSOR_MOTION_COALESCE = 1;
+    /** Cursor motion: the samples of the last frame are replayed in order, up to the history depth */
+    public static final int CURSOR_MOTION_HISTORY = 2;
+
+    // Batched input, record layout must match GLFWInputBatchRecord in input_bridge_v3.c
+    private static final int EVENT_TYPE_CHAR = 1000;
+    private static final int EVENT_TYPE_CHAR_MODS = 1001;
+    private static final int EVENT_TYPE_CURSOR_POS = 1003;
+    private static final int EVENT_TYPE_KEY = 1005;
+    private static final int EVENT_TYPE_MOUSE_BUTTON = 1006;
+    private static final int EVENT_TYPE_SCROLL = 1007;
+    private static final int EVENT_TYPE_CURSOR_DELTA = 1009;
+    private static final int BATCH_RECORD_SIZE = 20;
+    private static final int BATCH_CAPACITY = 256;
+    private static ByteBuffer sInputBatch;
+    private static int sInputBatchCount;
+
+    /** Gestures recognized by {@link #sendTouchEvent}, see {@link #nativeSetGestureConfig} */
+    public static final int GESTURE_TAP = 1;
+    public static final int GESTURE_LONG_PRESS = 1 << 1;
+    public static final int GESTURE_PINCH_SCROLL = 1 << 2;
+    public static final int GESTURE_TWO_FINGER_CLICK = 1 << 3;
+    public static final int GESTURE_CAMERA_DRAG = 1 << 4;
+
+    // Gamepad state, layout must match GLFWGamepadShared in environ.h
+    public static final int GAMEPAD_BUTTON_COUNT = 15;
+    public static final int GAMEPAD_AXIS_COUNT = 6;
+    private static final int GAMEPAD_AXES_OFFSET = 16;
+    private static final int GAMEPAD_CONNECTED_OFFSET = 40;
+    private static ByteBuffer sGamepad;
+
+    // Touch buffer, layout must match gesture_touch_buffer_t in gesture_engine.h
+    private static final int TOUCH_MAX_POINTERS = 10;
+    private static final int TOUCH_HEADER_SIZE = 8;
+    private static final int TOUCH_POINTER_SIZE = 12;
+    private static ByteBuffer sTouchBuffer;
+    private static Handler sTouchHandler;
+    private static int sLongPressMs = 300;
+    private static Runnable sLongPressListener;
+    private static final Runnable sTouchTick = () -> {
+        if (nativeTouchTick(SystemClock.uptimeMillis()) && sLongPressListener != null) sLongPressListener.run();
+    };
+
     public static volatile int windowWidth, windowHeight;
     public static volatile int physicalWidth, physicalHeight;
     public static float mouseX, mouseY;
@@ -81,7 +138,12 @@ public class CallbackBridge {
         nativeSendCursorPos(mouseX, mouseY);
     }
 
+    /** While grabbing, the delta goes to the game as raw motion, without rounding and without a synthetic cursor */
     public static void sendCursorDelta(float x, float y) {
+        if (isGrabbing) {
+            nativeSendCursorDelta(x, y);
+            return;
+        }
         sendCursorPos(mouseX + x, mouseY + y);
     }
 
@@ -140,6 +202,141 @@ public class CallbackBridge {
         nativeSendScreenSize(w, h);
     }
 
+    /**
+     * Reserve the next record of the shared batch buffer, flushing it first when it is full.
+     * The batch* methods must all be called from the thread that calls {@link #submitBatch()}.
+     */
+    private static ByteBuffer obtainBatchRecord(int type) {
+        if (sInputBatch == null) {
+            sInputBatch = ByteBuffer.allocateDirect(BATCH_CAPACITY * BATCH_RECORD_SIZE).order(ByteOrder.nativeOrder());
+            nativeRegisterInputBatch(sInputBatch);
+        }
+        if (sInputBatchCount == BATCH_CAPACITY) submitBatch();
+        sInputBatch.position(sInputBatchCount++ * BATCH_RECORD_SIZE);
+        sInputBatch.putInt(type);
+        return sInputBatch;
+    }
+
+    public static void batchCursorPos(float x, float y) {
+        mouseX = x;
+        mouseY = y;
+        obtainBatchRecord(EVENT_TYPE_CURSOR_POS).putFloat(x).putFloat(y);
+    }
+
+    public static void batchCursorDelta(float x, float y) {
+        if (isGrabbing) {
+            obtainBatchRecord(EVENT_TYPE_CURSOR_DELTA).putFloat(x).putFloat(y);
+            return;
+        }
+        batchCursorPos(mouseX + x, mouseY + y);
+    }
+
+    public static void batchKey(int keycode, int scancode, int modifiers, boolean isDown) {
+        obtainBatchRecord(EVENT_TYPE_KEY).putInt(keycode).putInt(scancode).putInt(isDown ? 1 : 0).putInt(modifiers);
+    }
+
+    public static void batchChar(char keychar, int modifiers) {
+        obtainBatchRecord(EVENT_TYPE_CHAR_MODS).putInt(keychar).putInt(modifiers);
+        obtainBatchRecord(EVENT_TYPE_CHAR).putInt(keychar);
+    }
+
+    public static void batchMouseButton(int button, int modifiers, boolean isDown) {
+        obtainBatchRecord(EVENT_TYPE_MOUSE_BUTTON).putInt(button).putInt(isDown ? 1 : 0).putInt(modifiers);
+    }
+
+    public static void batchScroll(double xoffset, double yoffset) {
+        obtainBatchRecord(EVENT_TYPE_SCROLL).putFloat((float) xoffset).putFloat((float) yoffset);
+    }
+
+    /**
+     * Hand a touch event to the native gesture engine, which turns it into clicks, scrolling and cursor motion.
+     * Must be called from the main thread.
+     * @param scale window pixels per view pixel
+     */
+    public static void sendTouchEvent(MotionEvent event, float scale) {
+        if (sTouchBuffer == null) {
+            sTouchBuffer = ByteBuffer.allocateDirect(TOUCH_HEADER_SIZE + TOUCH_MAX_POINTERS * TOUCH_POINTER_SIZE)
+                    .order(ByteOrder.nativeOrder());
+            nativeRegisterTouchBuffer(sTouchBuffer);
+            sTouchHandler = new Handler(Looper.getMainLooper());
+        }
+        int pointerCount = Math.min(event.getPointerCount(), TOUCH_MAX_POINTERS);
+        sTouchBuffer.putFloat(0, mouseX).putFloat(4, mouseY);
+        for (int i = 0; i < pointerCount; i++) {
+            int offset = TOUCH_HEADER_SIZE + i * TOUCH_POINTER_SIZE;
+            sTouchBuffer.putInt(offset, event.getPointerId(i))
+                    .putFloat(offset + 4, event.getX(i) * scale)
+                    .putFloat(offset + 8, event.getY(i) * scale);
+        }
+
+        int action = event.getActionMasked();
+        nativeSendTouchEvent(action, event.getPointerId(event.getActionIndex()), pointerCount,
+                getCurrentMods(), event.getEventTime());
+        mouseX = sTouchBuffer.getFloat(0);
+        mouseY = sTouchBuffer.getFloat(4);
+
+        if (action == MotionEvent.ACTION_DOWN) {
+            sTouchHandler.removeCallbacks(sTouchTick);
+            sTouchHandler.postAtTime(sTouchTick, event.getDownTime() + sLongPressMs);
+        } else if (action == MotionEvent.ACTION_UP || action == MotionEvent.ACTION_CANCEL) {
+            sTouchHandler.removeCallbacks(sTouchTick);
+        }
+    }
+
+    /**
+     * @param sensitivity camera pixels per finger pixel
+     * @param acceleration exponent applied to the finger speed, 1 is linear
+     * @param tapSlop how far a finger may move and still tap, in window pixels
+     * @param scrollStep pinch travel per scroll step, in window pixels
+     */
+    public static void setGestureConfig(int gestures, float sensitivity, float acceleration, int longPressMs,
+                                        float tapSlop, float scrollStep) {
+        sLongPressMs = longPressMs;
+        nativeSetGestureConfig(gestures, sensitivity, acceleration, longPressMs, tapSlop, scrollStep);
+    }
+
+    /** Called on the main thread when a long press starts, for haptic feedback */
+    public static void setLongPressListener(@Nullable Runnable listener) {
+        sLongPressListener = listener;
+    }
+
+    private static ByteBuffer obtainGamepad() {
+        if (sGamepad == null) {
+            sGamepad = nativeGetGamepadBuffer().order(ByteOrder.nativeOrder());
+        }
+        return sGamepad;
+    }
+
+    /**
+     * The game polls the gamepad state (GLFW joystick 1) straight from shared memory,
+     * so updating it costs no native call and no event.
+     */
+    public static void setGamepadConnected(boolean connected) {
+        ByteBuffer gamepad = obtainGamepad();
+        // The game always sees joystick 1, a disconnected gamepad is one left at rest
+        if (!connected) {
+            for (int i = 0; i < GAMEPAD_CONNECTED_OFFSET; i++) gamepad.put(i, (byte) 0);
+        }
+        gamepad.putInt(GAMEPAD_CONNECTED_OFFSET, connected ? 1 : 0);
+    }
+
+    /** @param button a GLFW_GAMEPAD_BUTTON_* index */
+    public static void setGamepadButton(int button, boolean isDown) {
+        obtainGamepad().put(button, (byte) (isDown ? 1 : 0));
+    }
+
+    /** @param axis a GLFW_GAMEPAD_AXIS_* index, value from -1 to 1 */
+    public static void setGamepadAxis(int axis, float value) {
+        obtainGamepad().putFloat(GAMEPAD_AXES_OFFSET + axis * 4, value);
+    }
+
+    /** Hand every batched event to the game with a single native call. */
+    public static void submitBatch() {
+        if (sInputBatchCount == 0) return;
+        nativeSubmitBatch(sInputBatchCount);
+        sInputBatchCount = 0;
+    }
+
     public static boolean isGrabbing() {
         // Avoid going through the JNI each time.
         return isGrabbing;
@@ -290,6 +487,14 @@ public class CallbackBridge {
     @CriticalNative
     public static native void nativeSetUseInputStackQueue(boolean useInputStackQueue);
 
+    @Keep
+    @CriticalNative
+    public static native void nativeSetInputOverflowPolicy(int policy);
+
+    @Keep
+    @CriticalNative
+    public static native void nativeSetCursorMotionMode(int mode, int historyDepth);
+
     @Keep
     @CriticalNative
     private static native boolean nativeSendChar(char codepoint);
@@ -308,6 +513,10 @@ public class CallbackBridge {
     @CriticalNative
     private static native void nativeSendCursorPos(float x, float y);
 
+    @Keep
+    @CriticalNative
+    private static native void nativeSendCursorDelta(float x, float y);
+
     @Keep
     @CriticalNative
     private static native void nativeSendMouseButton(int button, int action, int mods);
@@ -320,6 +529,32 @@ public class CallbackBridge {
     @CriticalNative
     private static native void nativeSendScreenSize(int width, int height);
 
+    @Keep
+    @CriticalNative
+    private static native int nativeSubmitBatch(int count);
+
+    @Keep
+    private static native void nativeRegisterInputBatch(ByteBuffer buffer);
+
+    @Keep
+    @CriticalNative
+    private static native void nativeSendTouchEvent(int action, int actionPointerId, int pointerCount, int mods, long eventTime);
+
+    @Keep
+    @CriticalNative
+    private static native boolean nativeTouchTick(long uptime);
+
+    @Keep
+    @CriticalNative
+    private static native void nativeSetGestureConfig(int gestures, float sensitivity, float acceleration, int longPressMs,
+                                                      float tapSlop, float scrollStep);
+
+    @Keep
+    private static native void nativeRegisterTouchBuffer(ByteBuffer buffer);
+
+    @Keep
+    private static native ByteBuffer nativeGetGamepadBuffer();
+
     @Keep
     public static native void nativeSetWindowAttrib(int attrib, int value);
 